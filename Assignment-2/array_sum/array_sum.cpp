@@ -2,42 +2,223 @@
 #include<pthread.h>
 #include<semaphore.h>
 #include<sys/time.h>
-#define MAX_THREADS 10
-#define MAX_REPEAT 10
+#include<getopt.h>
+#include "../common/thread_pool.h"
+#include "../common/fast_loader.h"
+#include "../common/binary_array.h"
+#include "../common/spinlock.h"
+#include "../common/rw_locks.h"
+#include "../common/perf_counters.h"
+#include "../common/bench_harness.h"
+#include "../common/results.h"
+#include "../common/cpu_topology.h"
+#include "../common/numa_alloc.h"
+#include "../common/reduce_kernels.h"
+#include "../common/stream_probe.h"
+#include "../common/scheduler.h"
+#include "../common/barriers.h"
+#include "../common/futex_sync.h"
+#include "../common/lock_stats.h"
+#include "../common/stream_ring.h"
+#include "../common/process_pool.h"
 #define MAX_SUM_REPEAT 10
-#define MAX_FUNCTIONS 4
+#define MAX_FUNCTIONS 17
+#define MAX_PROCESS_FUNCTIONS 5
+#define MAX_RW_FUNCTIONS 4
+#define MAX_SCAN_FUNCTIONS 5
+#define RW_TABLE_SIZE 1024
+#define RW_READ_SPAN 8
+#define RW_SEED 20200301
+#define CACHE_LINE_SIZE 64
 #define MAX_ARRAY_SIZE (int)(1e9)
+#define STREAM_DEFAULT_BUFFER_MB 64
 using namespace std;
 
 typedef void* (*function_p) (void *);
 
-long long array_size, no_of_threads, global_sum, global_rank;
-int *arr;
-double running_time_avg[MAX_FUNCTIONS][MAX_THREADS];
-double running_time_max[MAX_FUNCTIONS][MAX_THREADS];
-double running_time_min[MAX_FUNCTIONS][MAX_THREADS];
+long long array_size, no_of_threads, global_sum;
+atomic<long long> global_rank;
+//the summed array holds elements of arr_type, every strategy sums a chunk of it with reduce_kernel
+const void *arr;
+uint32_t arr_type = ELEMENT_INT32;
+size_t arr_element_size = sizeof(int);
+reduce_kernel_p reduce_kernel;
+simd_isa isa;
+long long sum_granularity, cs_work;
+//extra work per element, growing linearly from 0 at the start of the array to cost_skew units at its end
+double cost_skew;
 pthread_mutex_t sum_mutex;
 sem_t sum_semaphore;
 pthread_rwlock_t sum_rwlock;
+binary_array_file arr_file;
+atomic<long long> atomic_sum;
 
+struct alignas(CACHE_LINE_SIZE) padded_sum {
+    long long value;
+};
+padded_sum *thread_partial_sum;
+tas_lock sum_tas_lock;
+ttas_lock sum_ttas_lock;
+ticket_lock sum_ticket_lock;
+mcs_lock sum_mcs_lock;
+clh_lock sum_clh_lock;
+futex_mutex sum_futex_mutex;
 
+//the strategies across forked processes publish through process-shared objects in one shm_open segment, which
+//also carries the parameters of the run, since a worker only sees the parent's memory as it was at the fork
+struct process_shared_state {
+    pthread_mutex_t mutex;
+    pthread_rwlock_t rwlock;
+    pthread_barrier_t barrier;
+    sem_t semaphore;
+    long long no_of_processes, granularity, cs_work;
+    alignas(CACHE_LINE_SIZE) long long sum;
+    alignas(CACHE_LINE_SIZE) atomic<long long> atomic_sum;
+};
+process_shared_state *process_state;
+padded_sum *process_partial_sum;
+size_t process_shared_bytes;
+process_pool processes;
+
+//one point of the (elements per lock acquisition, work inside the critical section) grid
+struct grid_point {
+    schedule_mode schedule;
+    long long granularity, cs_work;
+    vector<vector<bench_stats>> running_time;
+    vector<vector<perf_counts>> counters_avg;
+    //process cpu seconds per run (average over the measured runs)
+    vector<vector<double>> cpu_time;
+};
+vector<grid_point> grid;
+
+//the read-mostly lookup workload: a table that is read RW_READ_SPAN entries at a time and updated
+//under the write lock, read_threshold out of 10000 operations are reads
+atomic<long long> rw_table[RW_TABLE_SIZE];
+long long read_threshold;
+pthread_rw_lock table_rwlock;
+writer_preferring_rw_lock table_writer_rwlock;
+std_shared_mutex_lock table_shared_mutex;
+seq_lock table_seqlock;
+
+struct rw_mix_point {
+    double read_pct;
+    vector<vector<bench_stats>> running_time;
+    vector<vector<perf_counts>> counters_avg;
+    //process cpu seconds per run (average over the measured runs)
+    vector<vector<double>> cpu_time;
+};
+vector<rw_mix_point> rw_mix;
+
+//the prefix sum workload: the slice totals, their scan by rank 0 and the scan of every slice are three
+//phases separated by a barrier (and one more before the next pass), the result goes to scan_buffer
+typedef long long (*scan_kernel_p)(const void*, long long low, long long high, long long offset, long long *out, bool inclusive);
+scan_kernel_p scan_kernel;
+placed_buffer scan_buffer;
+long long *scan_out;
+bool scan_inclusive;
+posix_barrier scan_posix_barrier;
+condvar_barrier scan_condvar_barrier;
+sense_reversing_barrier scan_sense_barrier;
+std_barrier scan_std_barrier;
+futex_barrier scan_futex_barrier;
+
+struct scan_point {
+    bool inclusive;
+    vector<vector<bench_stats>> running_time;
+    vector<vector<perf_counts>> counters_avg;
+    //process cpu seconds per run (average over the measured runs)
+    vector<vector<double>> cpu_time;
+    int no_of_mismatches;
+};
+vector<scan_point> scans;
+
+//the out-of-core reduction of a binary file that is never loaded: the first stream_readers ranks pread it block by
+//block into the ring, the other ranks sum the blocks, so only the ring's buffers are ever in memory
+stream_ring ring;
+int stream_readers;
+bool stream_verify;
+struct alignas(CACHE_LINE_SIZE) stream_thread_stats {
+    //seconds spent in pread (readers) or summing (compute threads), and the checksum of the summed blocks
+    double busy;
+    uint64_t checksum;
+};
+stream_thread_stats *stream_stats;
+
+struct stream_point {
+    vector<bench_stats> running_time;
+    //per run, averaged over the measured runs: the read and compute time per thread of each kind, and
+    //which fraction of the shorter of the two was hidden behind the other
+    vector<double> io_time, compute_time, overlap, cpu_time;
+    int no_of_mismatches;
+};
+
+//hardware/software counters of the pool workers, only opened with --perf
+bool perf_enabled;
+perf_session perf;
+bench_config bench;
+results_config output;
+
+//the thread counts of the sweep, every one of them is run on the first workers of the pool, whose
+//ranks are pinned to cpus according to the affinity policy
+cpu_topology topology;
+vector<int> thread_counts;
+int max_threads;
+affinity_policy affinity = AFFINITY_NONE;
+
+//where the pages of the summed array are placed, with anything but the defaults the loaded array is
+//copied into arr_buffer (by the workers themselves for first touch) before the sweep starts
+numa_placement placement = PLACEMENT_DEFAULT;
+page_kind pages = PAGES_DEFAULT;
+placed_buffer arr_buffer;
+const void *arr_source;
+
+//how the chunks of the array are handed to the workers (busy waiting always keeps its static slices, its
+//turns go round robin), and the spinning threads started next to them to slow some of them down
+chunk_scheduler scheduler;
+long long schedule_chunk = SCHEDULE_DEFAULT_CHUNK;
+int no_of_hogs;
+cpu_hog hogs;
+
+//simulated work of cs_work units done while holding the lock (the lock-free strategies have no
+//lock to hold, they do the same work right before publishing their partial sum)
+static inline void critical_section_work() {
+    for(long long unit = 0; unit < cs_work; unit++)
+        asm volatile("" ::: "memory");
+}
+
+//the injected imbalance of the elements [low, high), so that equal slices are no longer equal work
+static inline void skew_work(long long low, long long high) {
+    if(cost_skew == 0) return;
+    long long units = cost_skew * (high - low) * (double) (low + high) / (2.0 * array_size);
+    for(long long unit = 0; unit < units; unit++)
+        asm volatile("" ::: "memory");
+}
+
+
+//the turns go round robin, so every thread takes the same number of turns (as if its slice had the
+//full block size) even if its slice is shorter, otherwise the others would wait for it forever
 void* busy_wait_sum(void *arg) {
     
     int my_rank = *((int*) arg);
-    int my_low = (array_size + no_of_threads - 1) / no_of_threads * my_rank;
-    int my_high = min(my_low + (array_size + no_of_threads - 1) / no_of_threads, array_size);
+    long long my_block = (array_size + no_of_threads - 1) / no_of_threads;
+    long long my_low = my_block * my_rank;
+    long long my_high = min(my_low + my_block, array_size);
+    long long my_chunk = (sum_granularity == 0) ? my_block : sum_granularity;
     long long my_sum = 0;
 
     for(int k = 0; k < MAX_SUM_REPEAT; k++) {
-        for(int i = my_low; i < my_high; i++)
-            my_sum += arr[i];
+        for(long long chunk_low = my_low; chunk_low < my_low + my_block; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
 
-        while(global_rank != my_rank); {
+            LOCK_STATS_ACQUIRE(my_rank, while(global_rank != my_rank) {});
             global_sum += my_sum;
-            global_rank = (global_rank + 1) % no_of_threads;
-        }
+            critical_section_work();
+            LOCK_STATS_RELEASE(my_rank, global_rank = (global_rank + 1) % no_of_threads);
         
-        my_sum = 0;
+            my_sum = 0;
+        }
     }
 
     return NULL;
@@ -47,19 +228,22 @@ void* busy_wait_sum(void *arg) {
 void* mutex_sum(void *arg) {
 
     int my_rank = *((int*) arg);
-    int my_low = (array_size + no_of_threads - 1) / no_of_threads * my_rank;
-    int my_high = min(my_low + (array_size + no_of_threads - 1) / no_of_threads, array_size);
-    long long my_sum = 0;
+    long long my_low, my_high, my_sum = 0;
     
-    for(int k = 0; k < MAX_SUM_REPEAT; k++) {
-        for(int i = my_low; i < my_high; i++)
-            my_sum += arr[i];
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
 
-        pthread_mutex_lock(&sum_mutex);
-        global_sum += my_sum;
-        pthread_mutex_unlock(&sum_mutex);
+            LOCK_STATS_ACQUIRE(my_rank, pthread_mutex_lock(&sum_mutex));
+            global_sum += my_sum;
+            critical_section_work();
+            LOCK_STATS_RELEASE(my_rank, pthread_mutex_unlock(&sum_mutex));
 
-        my_sum = 0;
+            my_sum = 0;
+        }
     }
 
     return NULL;
@@ -69,19 +253,22 @@ void* mutex_sum(void *arg) {
 void *semaphore_sum(void *arg) {
 
     int my_rank = *((int*) arg);
-    int my_low = (array_size + no_of_threads - 1) / no_of_threads * my_rank;
-    int my_high = min(my_low + (array_size + no_of_threads - 1) / no_of_threads, array_size);
-    long long my_sum = 0;
+    long long my_low, my_high, my_sum = 0;
     
-    for(int k = 0; k < MAX_SUM_REPEAT; k++) {
-        for(int i = my_low; i < my_high; i++)
-            my_sum += arr[i];
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
 
-        sem_wait(&sum_semaphore);
-        global_sum += my_sum;
-        sem_post(&sum_semaphore);
+            LOCK_STATS_ACQUIRE(my_rank, sem_wait(&sum_semaphore));
+            global_sum += my_sum;
+            critical_section_work();
+            LOCK_STATS_RELEASE(my_rank, sem_post(&sum_semaphore));
 
-        my_sum = 0;
+            my_sum = 0;
+        }
     }
 
     return NULL;
@@ -90,59 +277,917 @@ void *semaphore_sum(void *arg) {
 void *rwlock_sum(void *arg) {
 
     int my_rank = *((int*) arg);
-    int my_low = (array_size + no_of_threads - 1) / no_of_threads * my_rank;
-    int my_high = min(my_low + (array_size + no_of_threads - 1) / no_of_threads, array_size);
-    long long my_sum = 0;
+    long long my_low, my_high, my_sum = 0;
+    
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+
+            LOCK_STATS_ACQUIRE(my_rank, pthread_rwlock_wrlock(&sum_rwlock));
+            global_sum += my_sum;
+            critical_section_work();
+            LOCK_STATS_RELEASE(my_rank, pthread_rwlock_unlock(&sum_rwlock));
+
+            my_sum = 0;
+        }
+    }
+
+    return NULL;
+}
+
+template<class Lock, Lock *sum_lock>
+void* spinlock_sum(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high, my_sum = 0;
     
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+
+            LOCK_STATS_ACQUIRE(my_rank, sum_lock->lock());
+            global_sum += my_sum;
+            critical_section_work();
+            LOCK_STATS_RELEASE(my_rank, sum_lock->unlock());
+
+            my_sum = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+template<memory_order order>
+void* atomic_sum_fetch_add(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high, my_sum = 0;
+    
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+
+            critical_section_work();
+            atomic_sum.fetch_add(my_sum, order);
+
+            my_sum = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+void* cas_loop_sum(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high, my_sum = 0;
+    
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+
+            critical_section_work();
+            long long old_sum = atomic_sum.load(memory_order_relaxed);
+            while(!atomic_sum.compare_exchange_weak(old_sum, old_sum + my_sum));
+
+            my_sum = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+//every thread owns a cache line sized slot, the slots are added up by the main thread after the join
+void* padded_partial_sum(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high, my_sum = 0;
+    
+    while(scheduler.next(my_rank, my_low, my_high)) {
+        long long my_chunk = (sum_granularity == 0) ? my_high - my_low : sum_granularity;
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            my_sum += reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+
+            critical_section_work();
+            thread_partial_sum[my_rank].value += my_sum;
+
+            my_sum = 0;
+        }
+    }
+
+    return NULL;
+}
+
+//the process strategies split the array into static slices (the schedulers live in private memory) and call
+//publish(sum) for every chunk of sum_granularity elements and end_of_pass(my_rank) (if given) after every pass
+template<class Publish>
+static inline void process_slice_sum(int my_rank, Publish publish, void (*end_of_pass)(int) = NULL) {
+
+    no_of_threads = process_state->no_of_processes;
+    sum_granularity = process_state->granularity;
+    cs_work = process_state->cs_work;
+    long long my_block = (array_size + no_of_threads - 1) / no_of_threads;
+    long long my_low = min(my_block * my_rank, array_size);
+    long long my_high = min(my_low + my_block, array_size);
+    long long my_chunk = (sum_granularity == 0) ? my_block : sum_granularity;
+
+    for(int k = 0; k < MAX_SUM_REPEAT; k++) {
+        for(long long chunk_low = my_low; chunk_low < my_high; chunk_low += my_chunk) {
+            long long chunk_high = min(chunk_low + my_chunk, my_high);
+            long long my_sum = reduce_kernel(arr, chunk_low, chunk_high);
+            skew_work(chunk_low, chunk_high);
+            publish(my_sum);
+        }
+        if(end_of_pass != NULL) end_of_pass(my_rank);
+    }
+}
+
+void* process_mutex_sum(void *arg) {
+    process_slice_sum(*((int*) arg), [](long long my_sum) {
+        pthread_mutex_lock(&process_state->mutex);
+        process_state->sum += my_sum;
+        critical_section_work();
+        pthread_mutex_unlock(&process_state->mutex);
+    });
+    return NULL;
+}
+
+void* process_semaphore_sum(void *arg) {
+    process_slice_sum(*((int*) arg), [](long long my_sum) {
+        while(sem_wait(&process_state->semaphore));
+        process_state->sum += my_sum;
+        critical_section_work();
+        sem_post(&process_state->semaphore);
+    });
+    return NULL;
+}
+
+void* process_rwlock_sum(void *arg) {
+    process_slice_sum(*((int*) arg), [](long long my_sum) {
+        pthread_rwlock_wrlock(&process_state->rwlock);
+        process_state->sum += my_sum;
+        critical_section_work();
+        pthread_rwlock_unlock(&process_state->rwlock);
+    });
+    return NULL;
+}
+
+//lock-free atomics are address free, so the same fetch_add works on a shared mapping
+void* process_atomic_sum(void *arg) {
+    process_slice_sum(*((int*) arg), [](long long my_sum) {
+        critical_section_work();
+        process_state->atomic_sum.fetch_add(my_sum, memory_order_relaxed);
+    });
+    return NULL;
+}
+
+//every process adds into its padded slot, after each pass over the array the processes meet at the barrier and
+//the serial one (the one pthread_barrier_wait picks) folds the slots into the sum, the second wait keeps the
+//others from adding to their slots before that
+static void process_barrier_fold(int) {
+    if(pthread_barrier_wait(&process_state->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+        for(int rank = 0; rank < process_state->no_of_processes; rank++) {
+            process_state->sum += process_partial_sum[rank].value;
+            process_partial_sum[rank].value = 0;
+        }
+    }
+    pthread_barrier_wait(&process_state->barrier);
+}
+
+void* process_barrier_sum(void *arg) {
+    int my_rank = *((int*) arg);
+    process_slice_sum(my_rank, [my_rank](long long my_sum) {
+        critical_section_work();
+        process_partial_sum[my_rank].value += my_sum;
+    }, process_barrier_fold);
+    return NULL;
+}
+
+//the process-shared objects, in the segment allocated before the workers are forked
+void init_process_state() {
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&process_state->mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    pthread_rwlockattr_t rwlock_attr;
+    pthread_rwlockattr_init(&rwlock_attr);
+    pthread_rwlockattr_setpshared(&rwlock_attr, PTHREAD_PROCESS_SHARED);
+    pthread_rwlock_init(&process_state->rwlock, &rwlock_attr);
+    pthread_rwlockattr_destroy(&rwlock_attr);
+
+    sem_init(&process_state->semaphore, 1, 1);
+    pthread_barrier_init(&process_state->barrier, NULL, 1);
+}
+
+//before every run of a process strategy, while none of the workers uses the segment
+void reset_process_state(int no_of_processes) {
+    process_state->no_of_processes = no_of_processes;
+    process_state->granularity = sum_granularity;
+    process_state->cs_work = cs_work;
+    process_state->sum = 0;
+    process_state->atomic_sum = 0;
+    for(int rank = 0; rank < no_of_processes; rank++)
+        process_partial_sum[rank].value = 0;
+
+    pthread_barrierattr_t barrier_attr;
+    pthread_barrierattr_init(&barrier_attr);
+    pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_destroy(&process_state->barrier);
+    pthread_barrier_init(&process_state->barrier, &barrier_attr, no_of_processes);
+    pthread_barrierattr_destroy(&barrier_attr);
+}
+
+void destroy_process_state() {
+    pthread_mutex_destroy(&process_state->mutex);
+    pthread_rwlock_destroy(&process_state->rwlock);
+    sem_destroy(&process_state->semaphore);
+    pthread_barrier_destroy(&process_state->barrier);
+    shared_free(process_state, process_shared_bytes);
+}
+
+//one lookup or update per array element of the slice, the element decides (through a counter based
+//random number) whether it is a read and which table entries it touches, and is added to them on a write
+template<class RWLock, RWLock *table_lock>
+void* rw_mix_lookup(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low = (array_size + no_of_threads - 1) / no_of_threads * my_rank;
+    long long my_high = min(my_low + (array_size + no_of_threads - 1) / no_of_threads, array_size);
+    long long my_sum = 0;
+
+    for(long long i = my_low; i < my_high; i++) {
+        uint64_t random = counter_rng(RW_SEED, i);
+        int slot = (random >> 32) % RW_TABLE_SIZE;
+
+        if((long long) (random % 10000) < read_threshold) {
+            long long value;
+            unsigned token;
+            bool consistent;
+            do {
+                LOCK_STATS_ACQUIRE(my_rank, token = table_lock->read_lock());
+                value = 0;
+                for(int j = 0; j < RW_READ_SPAN; j++)
+                    value += rw_table[(slot + j) % RW_TABLE_SIZE].load(memory_order_relaxed);
+                LOCK_STATS_RELEASE(my_rank, consistent = table_lock->read_unlock(token));
+            } while(!consistent);
+            my_sum += value;
+        } else {
+            LOCK_STATS_ACQUIRE(my_rank, table_lock->write_lock());
+            for(int j = 0; j < RW_READ_SPAN; j++) {
+                atomic<long long> &entry = rw_table[(slot + j) % RW_TABLE_SIZE];
+                entry.store(entry.load(memory_order_relaxed) + reduce_kernel(arr, i, i + 1), memory_order_relaxed);
+            }
+            LOCK_STATS_RELEASE(my_rank, table_lock->write_unlock());
+        }
+    }
+
+    thread_partial_sum[my_rank].value = my_sum;
+
+    return NULL;
+}
+
+//writes the inclusive or exclusive prefix sums of [low, high) plus offset to out[0, high - low) (if out is not
+//NULL) and returns the sum of the elements, floating point elements are rounded to integers one by one
+template<class T>
+long long scan_block(const void *data, long long low, long long high, long long offset, long long *out, bool inclusive) {
+    const T *values = (const T *) data;
+    //in unsigned arithmetic so that the sums wrap around instead of overflowing
+    unsigned long long running = offset;
+    for(long long i = low; i < high; i++) {
+        long long value = std::is_floating_point<T>::value ? llround(values[i]) : (long long) values[i];
+        if(out != NULL && !inclusive) out[i - low] = running;
+        running += value;
+        if(out != NULL && inclusive) out[i - low] = running;
+    }
+    return running - offset;
+}
+
+scan_kernel_p select_scan_kernel(uint32_t element_type) {
+    switch(element_type) {
+        case ELEMENT_INT8: return scan_block<int8_t>;
+        case ELEMENT_INT16: return scan_block<int16_t>;
+        case ELEMENT_INT64: return scan_block<int64_t>;
+        case ELEMENT_FLOAT: return scan_block<float>;
+        case ELEMENT_DOUBLE: return scan_block<double>;
+        default: return scan_block<int32_t>;
+    }
+}
+
+template<class Barrier, Barrier *scan_barrier>
+void* prefix_scan(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_block = (array_size + no_of_threads - 1) / no_of_threads;
+    long long my_low = min(my_block * my_rank, array_size);
+    long long my_high = min(my_low + my_block, array_size);
+
     for(int k = 0; k < MAX_SUM_REPEAT; k++) {
-        for(int i = my_low; i < my_high; i++)
-            my_sum += arr[i];
+        thread_partial_sum[my_rank].value = scan_kernel(arr, my_low, my_high, 0, NULL, scan_inclusive);
+        LOCK_STATS_WAIT(my_rank, scan_barrier->wait(my_rank));
+
+        //exclusive scan of the slice totals, each slot then holds the offset of its slice
+        if(my_rank == 0) {
+            long long offset = 0;
+            for(int rank = 0; rank < no_of_threads; rank++) {
+                long long total = thread_partial_sum[rank].value;
+                thread_partial_sum[rank].value = offset;
+                offset += total;
+            }
+        }
+        LOCK_STATS_WAIT(my_rank, scan_barrier->wait(my_rank));
+
+        scan_kernel(arr, my_low, my_high, thread_partial_sum[my_rank].value, scan_out + my_low, scan_inclusive);
+        //the slots are overwritten by the next pass
+        LOCK_STATS_WAIT(my_rank, scan_barrier->wait(my_rank));
+    }
+
+    return NULL;
+}
+
+//rank < stream_readers reads, the others sum, with stream_verify set they also checksum what they sum
+void* stream_sum(void *arg) {
+
+    int my_rank = *((int*) arg);
+    stream_thread_stats &my_stats = stream_stats[my_rank];
+    if(my_rank < stream_readers) {
+        while(ring.read_next(my_stats.busy)) {}
+        return NULL;
+    }
+
+    long long block, my_sum = 0;
+    const char *data;
+    size_t bytes;
+    while(ring.acquire_next(block, data, bytes)) {
+        double start = monotonic_time();
+        my_sum += reduce_kernel(data, 0, bytes / arr_element_size);
+        if(stream_verify) {
+            //blocks are a multiple of 8 bytes long, so only the last one can end in a partial word
+            uint64_t first_word = block * (ring.block_bytes / 8);
+            my_stats.checksum += checksum_words((const uint64_t *) data, bytes / 8, first_word)
+                                 + checksum_tail(data + bytes / 8 * 8, bytes % 8, first_word + bytes / 8);
+        }
+        my_stats.busy += monotonic_time() - start;
+        ring.release(block);
+    }
+    thread_partial_sum[my_rank].value = my_sum;
+
+    return NULL;
+}
+
+//a sum of the prefix sums, to compare the parallel scans with the serial one
+long long scan_checksum() {
+    unsigned long long checksum = 0;
+    for(long long i = 0; i < array_size; i++) checksum += scan_out[i];
+    return checksum;
+}
+
+//the checksum of the serial scan, computed in a small buffer so that no page of scan_out is touched
+long long serial_scan_checksum() {
+    long long block[4096];
+    unsigned long long checksum = 0, offset = 0;
+    for(long long low = 0; low < array_size; low += 4096) {
+        long long high = min(low + 4096, array_size);
+        offset += scan_kernel(arr, low, high, offset, block, scan_inclusive);
+        for(long long i = 0; i < high - low; i++) checksum += block[i];
+    }
+    return checksum;
+}
+
+//the statistics printed for every (function, thread count), one table each
+struct stat_kind {
+    const char *name;
+    double (*value)(const bench_stats &);
+};
+stat_kind stat_kinds[] = {
+    {"average", [](const bench_stats &stats) { return stats.mean; }},
+    {"maximum", [](const bench_stats &stats) { return stats.max; }},
+    {"minimum", [](const bench_stats &stats) { return stats.min; }},
+    {"median", [](const bench_stats &stats) { return stats.median; }},
+    {"90th percentile", [](const bench_stats &stats) { return stats.p90; }},
+    {"99th percentile", [](const bench_stats &stats) { return stats.p99; }},
+    {"standard deviation of the", [](const bench_stats &stats) { return stats.stddev; }},
+    {"95% confidence interval (+/-) of the average", [](const bench_stats &stats) { return stats.ci_half_width; }}
+};
+
+string thread_counts_label() {
+    string label = "for";
+    for(int threads : thread_counts) label += " " + to_string(threads);
+    return label + " threads";
+}
+
+void print_stats(const string &what, const string functions_name[], const vector<vector<bench_stats>> &running_time) {
+    int no_of_functions = running_time.size();
+    for(auto &kind : stat_kinds) {
+        cout << "The " << kind.name << " time spent for " << what << " (" << thread_counts_label() << "):\n";
+        for(int function_no = 0; function_no < no_of_functions; function_no++) {
+            cout << functions_name[function_no] << " :\n\t";
+            for(auto &stats : running_time[function_no])
+                cout << setw(10) << fixed << setprecision(5) << kind.value(stats) << "\t";
+            cout << "\n\n";
+        }
+    }
+
+    auto serial = find(thread_counts.begin(), thread_counts.end(), 1);
+    if(serial != thread_counts.end()) {
+        int serial_no = serial - thread_counts.begin();
+        cout << "The speedup and parallel efficiency of the average time over 1 thread (" << thread_counts_label() << "):\n";
+        for(int function_no = 0; function_no < no_of_functions; function_no++) {
+            double serial_time = running_time[function_no][serial_no].mean;
+            cout << functions_name[function_no] << " :\n\t";
+            for(auto &stats : running_time[function_no])
+                cout << setw(10) << setprecision(2) << serial_time / stats.mean << "\t";
+            cout << "\n\t";
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+                cout << setw(9) << setprecision(1) << 100 * serial_time / running_time[function_no][count_no].mean / thread_counts[count_no] << "%\t";
+            cout << "\n\n";
+        }
+    }
+
+    cout << "The number of measured runs (outliers, * if the confidence interval target was not reached):\n";
+    for(int function_no = 0; function_no < no_of_functions; function_no++) {
+        cout << functions_name[function_no] << " :\n\t";
+        for(auto &stats : running_time[function_no])
+            cout << setw(10) << (to_string(stats.samples.size()) + " (" + to_string(stats.no_of_outliers) + ")"
+                                 + (stats.converged ? "" : "*")) << "\t";
+        cout << "\n\n";
+    }
+}
+
+//the bandwidth the average time corresponds to, and which fraction of the STREAM probe that is (close to 100%
+//the sum is memory bound, far below it the synchronisation or the compute dominates)
+void print_bandwidth(const string functions_name[], const vector<vector<bench_stats>> &running_time, double bytes_per_run,
+                     double stream_bandwidth) {
+    cout << "The bandwidth achieved in GB/s";
+    if(stream_bandwidth > 0) cout << " and as a percentage of the STREAM bandwidth";
+    cout << " (" << thread_counts_label() << "):\n";
+    for(size_t function_no = 0; function_no < running_time.size(); function_no++) {
+        cout << functions_name[function_no] << " :\n\t";
+        for(auto &stats : running_time[function_no])
+            cout << setw(10) << fixed << setprecision(2) << bytes_per_run / stats.mean / 1e9 << "\t";
+        if(stream_bandwidth > 0) {
+            cout << "\n\t";
+            for(auto &stats : running_time[function_no])
+                cout << setw(9) << setprecision(1) << 100 * bytes_per_run / stats.mean / stream_bandwidth << "%\t";
+        }
+        cout << "\n\n";
+    }
+}
 
-        pthread_rwlock_wrlock(&sum_rwlock);
-        global_sum += my_sum;
-        pthread_rwlock_unlock(&sum_rwlock);
+//the cpu time per run and how many cpus were busy on average, a strategy that sleeps while it waits stays close
+//to the thread count only while there is work for all threads, one that spins stays at it throughout
+void print_cpu_time(const string functions_name[], const vector<vector<bench_stats>> &running_time, const vector<vector<double>> &cpu_time) {
+    cout << "The cpu time per run in seconds and as a multiple of the average time (" << thread_counts_label() << "):\n";
+    for(size_t function_no = 0; function_no < cpu_time.size(); function_no++) {
+        cout << functions_name[function_no] << " :\n\t";
+        for(double seconds : cpu_time[function_no])
+            cout << setw(10) << fixed << setprecision(5) << seconds << "\t";
+        cout << "\n\t";
+        for(size_t count_no = 0; count_no < cpu_time[function_no].size(); count_no++)
+            cout << setw(9) << setprecision(2) << cpu_time[function_no][count_no] / running_time[function_no][count_no].mean << "x\t";
+        cout << "\n\n";
+    }
+}
 
-        my_sum = 0;
+//only the first no_of_measured functions have counters, the ones after them run outside the thread pool
+void print_counters(const string functions_name[], const vector<vector<perf_counts>> &counters_avg, size_t no_of_measured = SIZE_MAX) {
+    cout << "The performance counters per run (average over the runs, summed over the threads, " << thread_counts_label() << "):\n";
+    for(size_t function_no = 0; function_no < min(counters_avg.size(), no_of_measured); function_no++) {
+        cout << functions_name[function_no] << " :\n";
+        for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++) {
+            cout << "\t" << setw(16) << left << perf_event_names[event_no] << right;
+            for(auto &counters : counters_avg[function_no])
+                cout << setw(14) << fixed << setprecision(0) << counters.value[event_no] << "\t";
+            cout << "\n";
+        }
+        cout << "\n";
     }
+}
+
+//a worker copies the slice it owns at the largest thread count, so with first-touch placement the pages of
+//that slice end up on its node (smaller thread counts split the array differently and read some of them remotely)
+void* first_touch_copy(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_block = (array_size + max_threads - 1) / max_threads;
+    long long my_low = min(my_block * my_rank, array_size);
+    long long my_high = min(my_low + my_block, array_size);
+    memcpy((char *) arr_buffer.data + my_low * arr_element_size, (const char *) arr_source + my_low * arr_element_size,
+           (my_high - my_low) * arr_element_size);
 
     return NULL;
 }
 
+void free_array() {
+    if(arr_buffer.data != NULL) arr_buffer.release();
+    else if(arr_file.data != NULL) arr_file.close();
+    else delete[] (const int *) arr;
+}
+
+//parses a comma separated list of non negative integers
+bool parse_list(const char *str, vector<long long> &values) {
+    values.clear();
+    while(*str != '\0') {
+        char *end;
+        long long value = strtoll(str, &end, 10);
+        if(end == str || value < 0 || (*end != ',' && *end != '\0')) return false;
+        values.push_back(value);
+        str = (*end == ',') ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+//parses a comma separated list of schedule names
+bool parse_schedule_list(const char *str, vector<schedule_mode> &schedules) {
+    schedules.clear();
+    string list(str);
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = min(list.find(',', start), list.size());
+        schedule_mode schedule;
+        if(!parse_enum_name(list.substr(start, end - start).c_str(), schedule_mode_names, 4, schedule)) return false;
+        schedules.push_back(schedule);
+        start = end + 1;
+    }
+    return !schedules.empty();
+}
+
+//parses a comma separated list of "inclusive" and "exclusive", "none" gives an empty list
+bool parse_scan_list(const char *str, vector<bool> &inclusive) {
+    inclusive.clear();
+    if(strcmp(str, "none") == 0) return true;
+    string list(str);
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = min(list.find(',', start), list.size());
+        string kind = list.substr(start, end - start);
+        if(kind != "inclusive" && kind != "exclusive") return false;
+        inclusive.push_back(kind == "inclusive");
+        start = end + 1;
+    }
+    return !inclusive.empty();
+}
+
+//parses a comma separated list of percentages, "none" gives an empty list
+bool parse_percent_list(const char *str, vector<double> &values) {
+    values.clear();
+    if(strcmp(str, "none") == 0) return true;
+    while(*str != '\0') {
+        char *end;
+        double value = strtod(str, &end);
+        if(end == str || value < 0 || value > 100 || (*end != ',' && *end != '\0')) return false;
+        values.push_back(value);
+        str = (*end == ',') ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+//streams the binary input_file through a ring of no_of_buffers buffers of buffer_mb MB instead of loading it and
+//sweeps the compute thread counts with no_of_readers reader threads next to them, returns the exit status
+int out_of_core_sum(const char *input_file, int no_of_buffers, long long buffer_mb, int no_of_readers) {
+
+    int status = (input_file == NULL) ? BINARY_ARRAY_NOT_BINARY : arr_file.open(input_file, false);
+    if(status != BINARY_ARRAY_OK) {
+        cerr << (status == BINARY_ARRAY_INVALID ? "Malformed binary input file.\n" : "Streaming needs a binary input file.\n")
+             << "Terminating program........\n";
+        exit(0);
+    }
+    array_size = arr_file.header.count;
+    arr_type = arr_file.header.element_type;
+    arr_element_size = element_size(arr_type);
+    if(array_size < max_threads) {
+        cerr << "Invalid array size entered.\nTerminating program.......\n";
+        exit(0);
+    }
+    double data_bytes = (double) array_size * arr_element_size;
+    //whole MB, so no element straddles two blocks and every block starts on a checksum word
+    if(!ring.open(arr_file.fd, arr_file.header.data_offset, array_size * arr_element_size, buffer_mb << 20, no_of_buffers)) {
+        cerr << "Could not allocate the stream buffers.\nTerminating program........\n";
+        exit(0);
+    }
+
+    stream_readers = no_of_readers;
+    reduce_kernel = select_reduce_kernel(arr_type, isa);
+    int pool_threads = no_of_readers + max_threads;
+    thread_partial_sum = new padded_sum[pool_threads];
+    stream_stats = new stream_thread_stats[pool_threads];
+    thread_pool pool;
+    if(!pool.start(pool_threads)) {
+        cerr << "Error occurred during execution.\nTerminating program........\n";
+        exit(0);
+    }
+    vector<int> cpus = topology.cpu_order(affinity);
+    if(!pool.pin(cpus.data(), cpus.size()))
+        cerr << "Could not pin every worker to its cpu, continuing with the ones that could be pinned\n";
+
+    //one pass over the file with threads compute threads, the read and compute times are per thread of each kind
+    double io_time, compute_time;
+    uint64_t checksum;
+    auto run = [&](int threads) {
+        ring.reset();
+        //drops the file from the page cache, so that every run reads it from the device and not from memory
+        posix_fadvise(arr_file.fd, 0, 0, POSIX_FADV_DONTNEED);
+        for(int rank = 0; rank < no_of_readers + threads; rank++) {
+            stream_stats[rank].busy = 0;
+            stream_stats[rank].checksum = 0;
+            thread_partial_sum[rank].value = 0;
+        }
+        double time_taken = pool.run(stream_sum, no_of_readers + threads);
+
+        global_sum = 0;
+        io_time = compute_time = 0;
+        checksum = 0;
+        for(int rank = 0; rank < no_of_readers + threads; rank++) {
+            global_sum += thread_partial_sum[rank].value;
+            checksum += stream_stats[rank].checksum;
+            (rank < no_of_readers ? io_time : compute_time) += stream_stats[rank].busy;
+        }
+        io_time /= no_of_readers;
+        compute_time /= threads;
+        return time_taken;
+    };
+
+    //an unmeasured first pass checks the file against its checksum and gives the sum every later pass must match
+    stream_verify = true;
+    double verify_time = run(max_threads);
+    stream_verify = false;
+    if(ring.read_error || checksum != arr_file.header.checksum) {
+        cerr << (ring.read_error ? "Error reading the binary input file.\n" : "Checksum mismatch in binary input file.\n")
+             << "Terminating program........\n";
+        exit(0);
+    }
+    long long expected_sum = global_sum;
+
+    stream_point point;
+    point.no_of_mismatches = 0;
+    for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+
+        no_of_threads = thread_counts[count_no];
+        double io_total = 0, compute_total = 0, overlap_total = 0, cpu_total = 0;
+        point.running_time.push_back(bench_measure(bench, [&](bool warmup) {
+            double cpu_start = process_cpu_time();
+            double time_taken = run(no_of_threads);
+            point.no_of_mismatches += (global_sum != expected_sum || ring.read_error);
+            if(!warmup) {
+                cpu_total += process_cpu_time() - cpu_start;
+                io_total += io_time;
+                compute_total += compute_time;
+                //1 if the shorter of reading and summing ran entirely in the shadow of the longer, 0 if they ran one after the other
+                double shorter = min(io_time, compute_time);
+                if(shorter > 0) overlap_total += max(0.0, min(1.0, (io_time + compute_time - time_taken) / shorter));
+            }
+            return time_taken;
+        }));
+
+        double runs = point.running_time.back().samples.size();
+        point.io_time.push_back(io_total / runs);
+        point.compute_time.push_back(compute_total / runs);
+        point.overlap.push_back(overlap_total / runs);
+        point.cpu_time.push_back(cpu_total / runs);
+    }
+
+    string functions_name[] = {"StreamingSum"};
+    vector<vector<bench_stats>> running_time = {point.running_time};
+    cout << "For " << input_file << "\n";
+    cout << "\nThe sum of the array is: " << expected_sum << "\n";
+    cout << "The size of the array is: " << array_size << "\n";
+    cout << "Streamed " << fixed << setprecision(2) << data_bytes / (1 << 20) << " MB of " << element_type_name(arr_type)
+         << " elements in " << ring.no_of_blocks << " blocks through " << no_of_buffers << " buffers of " << buffer_mb << " MB ("
+         << no_of_buffers * buffer_mb << " MB in memory) with " << no_of_readers << " reader threads next to the compute threads\n";
+    cout << "Checksum verified while streaming in " << setprecision(5) << verify_time << " seconds, the file is dropped from the "
+         << "page cache before every run\n";
+    cout << "Reduction kernel: " << simd_isa_names[isa] << " on " << element_type_name(arr_type) << " elements\n";
+    cout << "Warmup runs: " << bench.warmup_runs << ", measured runs: " << bench.min_repeat << " to " << bench.max_repeat
+         << " until the 95% confidence interval is within " << setprecision(1) << bench.target_ci * 100 << "% of the average\n";
+    if(point.no_of_mismatches > 0) cout << point.no_of_mismatches << " runs DIFFER from the verified sum\n";
+    cout << "\n";
+
+    print_stats("streaming the array sum", functions_name, running_time);
+    print_bandwidth(functions_name, running_time, data_bytes, 0);
+    print_cpu_time(functions_name, running_time, {point.cpu_time});
+    cout << "The read and compute time per thread of each kind, and the overlap efficiency (how much of the shorter one "
+         << "was hidden behind the other, " << thread_counts_label() << "):\n";
+    cout << functions_name[0] << " :\n\t";
+    for(double seconds : point.io_time) cout << setw(10) << setprecision(5) << seconds << "\t";
+    cout << "\n\t";
+    for(double seconds : point.compute_time) cout << setw(10) << setprecision(5) << seconds << "\t";
+    cout << "\n\t";
+    for(double overlap : point.overlap) cout << setw(9) << setprecision(1) << 100 * overlap << "%\t";
+    cout << "\n\n";
+
+    result_set results;
+    results.program = "array_sum";
+    results.input = input_file;
+    results.problem_size = array_size;
+    results.host.collect();
+    string experiment = "out_of_core buffers=" + to_string(no_of_buffers) + " buffer_mb=" + to_string(buffer_mb)
+                        + " readers=" + to_string(no_of_readers) + " affinity=" + affinity_policy_names[affinity];
+    for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+        results.add(experiment, functions_name[0], thread_counts[count_no], point.running_time[count_no], NULL, data_bytes);
+    results.compute_speedup();
+
+    if(!results.write(output.output))
+        cerr << "Error writing the results to " << output.output << "\n";
+    int no_of_regressions = 0;
+    if(!output.baseline.empty()) {
+        no_of_regressions = compare_with_baseline(results, output.baseline, output.threshold);
+        if(no_of_regressions < 0) cerr << "Could not read the baseline " << output.baseline << "\n";
+    }
+
+    pool.stop();
+    ring.close();
+    arr_file.close();
+    delete[] thread_partial_sum;
+    delete[] stream_stats;
+
+    return (no_of_regressions > 0) ? 1 : 0;
+}
+
+void usage(const char *program_name) {
+    cerr << "Usage: " << program_name << " [options] [input_file]\n"
+         << "\t-g, --granularity LIST\telements summed between two lock acquisitions, 0 for the whole chunk (default 0)\n"
+         << "\t-w, --cs-work LIST\tunits of simulated work done inside the critical section (default 0)\n"
+         << "\t-p, --perf\t\tcapture hardware and software performance counters of the worker threads\n"
+         << "\t-t, --threads LIST\tthread counts to sweep: pow2 (default), all or a comma separated list, Nx is N times\n"
+         << "\t\t\t\tthe available cpus, at most " << MAX_OVERSUBSCRIPTION << "x\n"
+         << "\t-a, --affinity POLICY\tpin the workers: none (default), compact, scatter or physical (one per core)\n"
+         << "\t-m, --placement POLICY\tNUMA placement of the array: default, interleave or first-touch\n"
+         << "\t-H, --hugepages KIND\tpages of the array: default, thp (transparent) or huge (MAP_HUGETLB)\n"
+         << "\t-s, --simd ISA\t\treduction kernel: scalar, sse2, avx2 or avx512 (default the widest this cpu runs)\n"
+         << "\t-b, --bandwidth MB\tsize of each STREAM triad array for the bandwidth probe, 0 to skip (default "
+         << STREAM_DEFAULT_MB << ")\n"
+         << "\t-S, --schedule LIST\thow the array is split: static (default), dynamic, guided or stealing (work stealing),\n"
+         << "\t\t\t\tbusy waiting and the process strategies always run static\n"
+         << "\t-c, --chunk N\t\telements per chunk of the dynamic and stealing schedules, the smallest guided chunk\n"
+         << "\t\t\t\t(default " << SCHEDULE_DEFAULT_CHUNK << ")\n"
+         << "\t-k, --skew UNITS\textra work per element, growing linearly up to UNITS at the end of the array (default 0)\n"
+         << "\t-j, --hog N\t\tspin N background threads (on the cpus of the first workers if they are pinned)\n"
+         << "\t-r, --read-pct LIST\tpercentages of reads for the read-write lock workload (default 50,90,99,99.9, none to skip)\n"
+         << "\t-y, --spin N\t\tspin rounds of the futex mutex and barrier before they sleep, auto (default) adapts them\n"
+         << "\t-x, --scan LIST\t\tprefix sums to compute with each barrier: inclusive, exclusive (default both, none to skip)\n"
+         << "\t-O, --out-of-core N\tstream the binary input file through N buffers (2 double, 3 triple buffered) instead of\n"
+         << "\t\t\t\tloading it, only the sum is computed and the thread counts are those of the compute threads\n"
+         << "\t-B, --buffer-mb MB\tsize of each stream buffer (default " << STREAM_DEFAULT_BUFFER_MB << ")\n"
+         << "\t-R, --readers N\t\tthreads reading the file while streaming (default 1)\n"
+         << BENCH_USAGE
+         << RESULTS_USAGE
+         << "Every combination of the schedule, granularity and work lists is run. Without an input file the array is read from the console.\n";
+}
+
 int main(int argc, char **argv) {
 
+    vector<long long> granularity_list = {0}, cs_work_list = {0};
+    vector<double> read_pct_list = {50, 90, 99, 99.9};
+    vector<schedule_mode> schedule_list = {SCHEDULE_STATIC};
+    vector<bool> scan_list = {true, false};
+    int futex_spin = FUTEX_SPIN_ADAPTIVE;
+    int ring_buffers = 0, ring_readers = 1;
+    long long ring_buffer_mb = STREAM_DEFAULT_BUFFER_MB;
+    const char *threads_arg = "pow2";
+    long long stream_mb = STREAM_DEFAULT_MB;
+    topology.detect();
+    isa = detect_simd_isa();
+    simd_isa widest_isa = isa;
+    static struct option long_options[] = {
+        {"granularity", required_argument, NULL, 'g'},
+        {"cs-work", required_argument, NULL, 'w'},
+        {"read-pct", required_argument, NULL, 'r'},
+        {"threads", required_argument, NULL, 't'},
+        {"affinity", required_argument, NULL, 'a'},
+        {"placement", required_argument, NULL, 'm'},
+        {"hugepages", required_argument, NULL, 'H'},
+        {"simd", required_argument, NULL, 's'},
+        {"bandwidth", required_argument, NULL, 'b'},
+        {"schedule", required_argument, NULL, 'S'},
+        {"chunk", required_argument, NULL, 'c'},
+        {"skew", required_argument, NULL, 'k'},
+        {"hog", required_argument, NULL, 'j'},
+        {"scan", required_argument, NULL, 'x'},
+        {"spin", required_argument, NULL, 'y'},
+        {"out-of-core", required_argument, NULL, 'O'},
+        {"buffer-mb", required_argument, NULL, 'B'},
+        {"readers", required_argument, NULL, 'R'},
+        {"perf", no_argument, NULL, 'p'},
+        BENCH_LONG_OPTIONS,
+        RESULTS_LONG_OPTIONS,
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while((option = getopt_long(argc, argv, "g:w:r:t:a:m:H:s:b:S:c:k:j:x:y:O:B:R:ph", long_options, NULL)) != -1) {
+        bool ok = true;
+        char *end;
+        switch(option) {
+            case 'g': ok = parse_list(optarg, granularity_list); break;
+            case 'w': ok = parse_list(optarg, cs_work_list); break;
+            case 'r': ok = parse_percent_list(optarg, read_pct_list); break;
+            case 't': threads_arg = optarg; break;
+            case 'a': ok = parse_enum_name(optarg, affinity_policy_names, 4, affinity); break;
+            case 'm': ok = parse_enum_name(optarg, numa_placement_names, 3, placement); break;
+            case 'H': ok = parse_enum_name(optarg, page_kind_names, 3, pages); break;
+            case 's': ok = parse_enum_name(optarg, simd_isa_names, NO_OF_ISAS, isa) && isa <= widest_isa; break;
+            case 'b': stream_mb = strtoll(optarg, &end, 10); ok = (*end == '\0' && stream_mb >= 0); break;
+            case 'S': ok = parse_schedule_list(optarg, schedule_list); break;
+            case 'c': schedule_chunk = strtoll(optarg, &end, 10); ok = (*end == '\0' && schedule_chunk > 0); break;
+            case 'k': cost_skew = strtod(optarg, &end); ok = (*end == '\0' && cost_skew >= 0); break;
+            case 'j': no_of_hogs = strtol(optarg, &end, 10); ok = (*end == '\0' && no_of_hogs >= 0); break;
+            case 'x': ok = parse_scan_list(optarg, scan_list); break;
+            case 'y': ok = parse_spin_limit(optarg, futex_spin); break;
+            case 'O': ring_buffers = strtol(optarg, &end, 10); ok = (*end == '\0' && ring_buffers >= 2); break;
+            case 'B': ring_buffer_mb = strtoll(optarg, &end, 10); ok = (*end == '\0' && ring_buffer_mb > 0); break;
+            case 'R': ring_readers = strtol(optarg, &end, 10); ok = (*end == '\0' && ring_readers > 0); break;
+            case 'p': perf_enabled = true; break;
+            default: ok = bench_parse_option(option, optarg, bench) || results_parse_option(option, optarg, output);
+        }
+        if(!ok) {
+            usage(argv[0]);
+            exit(0);
+        }
+    }
+    if(!parse_thread_counts(threads_arg, topology.available_cpus(), thread_counts)) {
+        usage(argv[0]);
+        exit(0);
+    }
+    max_threads = *max_element(thread_counts.begin(), thread_counts.end());
+    const char *input_file = (optind < argc) ? argv[optind] : NULL;
+    if(ring_buffers > 0) return out_of_core_sum(input_file, ring_buffers, ring_buffer_mb, ring_readers);
 
-    if(argc == 1) {
 
-        cout << "Enter the size of the array (should be between " << MAX_THREADS << " and " 
+    if(input_file == NULL) {
+
+        cout << "Enter the size of the array (should be between " << max_threads << " and " 
              << MAX_ARRAY_SIZE << " inclusive): ";
         cin >> array_size;
-        if(array_size < MAX_THREADS || array_size > MAX_ARRAY_SIZE) {
+        if(array_size < max_threads || array_size > MAX_ARRAY_SIZE) {
             cerr << "Invalid array size entered.\nTerminating program.......\n";
             exit(0);
         }
 
-        arr = new int[array_size];
+        int *elements = new int[array_size];
         cout << "Enter the elements of the array: \n";
-        for(int i = 0; i < array_size; i++) {
+        for(long long i = 0; i < array_size; i++) {
             cout << "\tIndex" << setw(9) << (i + 1) << " :\t";
-            cin >> arr[i]; 
+            cin >> elements[i]; 
         }
+        arr = elements;
 
     } else {
         
-        ifstream fin(argv[1]);
-        if(fin.is_open()) {
+        double load_start = fast_loader::wall_time();
+        int status = arr_file.open(input_file);
+        fast_loader fin;
+        if(status == BINARY_ARRAY_OK) {
+
+            array_size = arr_file.header.count;
+            arr_type = arr_file.header.element_type;
+            arr_element_size = element_size(arr_type);
+            if(array_size < max_threads || array_size > MAX_ARRAY_SIZE) {
+                cerr << "Invalid array size entered.\nTerminating program.......\n";
+                exit(0);
+            }
+
+            arr = arr_file.data;
+            double load_time = fast_loader::wall_time() - load_start;
+            cout << "Mapped " << input_file << " (" << fixed << setprecision(2) << arr_file.size / (double) (1 << 20) << " MB binary) in "
+                 << setprecision(5) << load_time << " seconds (" << setprecision(2) << arr_file.size / load_time / (1 << 20) << " MB/s)\n";
+        } else if(status == BINARY_ARRAY_INVALID || status == BINARY_ARRAY_BAD_CHECKSUM) {
+            cerr << (status == BINARY_ARRAY_INVALID ? "Malformed binary input file.\n" : "Checksum mismatch in binary input file.\n")
+                 << "Terminating program........\n";
+            exit(0);
+        } else if(fin.open(input_file)) {
 
-            fin >> array_size;
-            if(array_size < MAX_THREADS || array_size > MAX_ARRAY_SIZE) {
+            if(!fin.read(array_size) || array_size < max_threads || array_size > MAX_ARRAY_SIZE) {
                 cerr << "Invalid array size entered.\nTerminating program.......\n";
                 exit(0);
             }
             
-            arr = new int[array_size];
-            for(int i = 0; i < array_size; i++)
-                fin >> arr[i]; 
+            int *elements = new int[array_size];
+            arr = elements;
+            if(!fin.read_array(elements, array_size)) {
+                cerr << "Invalid array elements in input file.\nTerminating program.......\n";
+                exit(0);
+            }
 
+            cout << "Loaded " << input_file << " (" << fixed << setprecision(2) << fin.size / (double) (1 << 20) << " MB) in "
+                 << setprecision(5) << fin.load_time << " seconds (" << setprecision(2) << fin.throughput() << " MB/s)\n";
             fin.close();
         } else {
             cerr << "Error opening input file.\nTerminating program........\n";
@@ -152,103 +1197,387 @@ int main(int argc, char **argv) {
     }
 
 
-    function_p thread_functions[4] = {&busy_wait_sum, &mutex_sum, &semaphore_sum, &rwlock_sum};
-    string thread_functions_name[] = {"BusyWaiting", "Mutex", "Semaphore", "ReadWriteLock"};
+    function_p thread_functions[MAX_FUNCTIONS] = {&busy_wait_sum, &mutex_sum, &semaphore_sum, &rwlock_sum,
+                                                  &atomic_sum_fetch_add<memory_order_relaxed>, &atomic_sum_fetch_add<memory_order_acquire>,
+                                                  &atomic_sum_fetch_add<memory_order_release>, &atomic_sum_fetch_add<memory_order_acq_rel>,
+                                                  &atomic_sum_fetch_add<memory_order_seq_cst>, &cas_loop_sum, &padded_partial_sum,
+                                                  &spinlock_sum<tas_lock, &sum_tas_lock>, &spinlock_sum<ttas_lock, &sum_ttas_lock>,
+                                                  &spinlock_sum<ticket_lock, &sum_ticket_lock>, &spinlock_sum<mcs_lock, &sum_mcs_lock>,
+                                                  &spinlock_sum<clh_lock, &sum_clh_lock>, &spinlock_sum<futex_mutex, &sum_futex_mutex>};
+    function_p process_functions[MAX_PROCESS_FUNCTIONS] = {&process_mutex_sum, &process_semaphore_sum, &process_rwlock_sum,
+                                                           &process_atomic_sum, &process_barrier_sum};
+    function_p rw_functions[MAX_RW_FUNCTIONS] = {&rw_mix_lookup<pthread_rw_lock, &table_rwlock>,
+                                                 &rw_mix_lookup<writer_preferring_rw_lock, &table_writer_rwlock>,
+                                                 &rw_mix_lookup<std_shared_mutex_lock, &table_shared_mutex>,
+                                                 &rw_mix_lookup<seq_lock, &table_seqlock>};
+    function_p scan_functions[MAX_SCAN_FUNCTIONS] = {&prefix_scan<posix_barrier, &scan_posix_barrier>,
+                                                     &prefix_scan<condvar_barrier, &scan_condvar_barrier>,
+                                                     &prefix_scan<sense_reversing_barrier, &scan_sense_barrier>,
+                                                     &prefix_scan<std_barrier, &scan_std_barrier>,
+                                                     &prefix_scan<futex_barrier, &scan_futex_barrier>};
+    string scan_functions_name[] = {"PthreadBarrier", "CondvarBarrier", "SenseReversingBarrier", "StdBarrier", "FutexBarrier"};
+    string rw_functions_name[] = {"PthreadRwlock", "WriterPreferringRwlock", "SharedMutex", "Seqlock"};
+    string thread_functions_name[] = {"BusyWaiting", "Mutex", "Semaphore", "ReadWriteLock", "AtomicRelaxed", "AtomicAcquire",
+                                      "AtomicRelease", "AtomicAcqRel", "AtomicSeqCst", "CASLoop", "PaddedPartialSums",
+                                      "TASSpinlock", "TTASBackoffSpinlock", "TicketSpinlock", "MCSLock", "CLHLock", "FutexMutex",
+                                      "ProcessMutex", "ProcessSemaphore", "ProcessRwlock", "ProcessAtomic", "ProcessBarrier"};
 
     pthread_mutex_init(&sum_mutex, NULL);
     sem_init(&sum_semaphore, 0, 1);
 
-    for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
-
-        for(no_of_threads = 1; no_of_threads <= MAX_THREADS; no_of_threads++) {
-
-            running_time_avg[function_no][no_of_threads - 1] = 0;
-            running_time_max[function_no][no_of_threads - 1] = - DBL_MAX;
-            running_time_min[function_no][no_of_threads - 1] = DBL_MAX;
-
-            for(int repeat_count = 0; repeat_count < MAX_REPEAT; repeat_count++) {
-                
-                global_sum = global_rank = 0;
-                struct timeval start_time, end_time; 
-                gettimeofday(&start_time, NULL);
-
-                pthread_t threads[no_of_threads];
-                int thread_arg[no_of_threads];
-
-                for(int thread_no = 0; thread_no < no_of_threads; thread_no++) {
-                    thread_arg[thread_no] = thread_no;
-                    int ret = pthread_create(&threads[thread_no], NULL, thread_functions[function_no], (void *) (&thread_arg[thread_no]));
-                    if(ret != 0) {
-                        cerr << "Error occurred during execution.\nTerminating program........\n";
-                        for(int thread__no = 0; thread__no < thread_no; thread__no++)
-                            pthread_cancel(threads[thread__no]);
-                            
-                        delete[] arr;
-                        pthread_mutex_destroy(&sum_mutex);
-                        sem_destroy(&sum_semaphore);
-                        exit(0);
+    sum_futex_mutex.spin.limit = scan_futex_barrier.spin.limit = futex_spin;
+
+    thread_partial_sum = new padded_sum[max_threads];
+    thread_pool pool;
+    if(!pool.start(max_threads)) {
+        cerr << "Error occurred during execution.\nTerminating program........\n";
+        free_array();
+        pthread_mutex_destroy(&sum_mutex);
+        sem_destroy(&sum_semaphore);
+        exit(0);
+    }
+    if(perf_enabled && !perf.open(pool.tid, max_threads)) {
+        cerr << "Could not open the performance counters (check /proc/sys/kernel/perf_event_paranoid), continuing without them\n";
+        perf_enabled = false;
+    }
+    vector<int> cpus = topology.cpu_order(affinity);
+    if(!pool.pin(cpus.data(), cpus.size()))
+        cerr << "Could not pin every worker to its cpu, continuing with the ones that could be pinned\n";
+
+    if(placement != PLACEMENT_DEFAULT || pages != PAGES_DEFAULT) {
+        if(!arr_buffer.allocate(array_size * arr_element_size, placement, pages)) {
+            cerr << "Could not allocate the placed array, continuing with the loaded one\n";
+        } else {
+            arr_source = arr;
+            arr = arr_buffer.data;
+            if(placement == PLACEMENT_FIRST_TOUCH) pool.run(first_touch_copy, max_threads);
+            else memcpy(arr_buffer.data, arr_source, array_size * arr_element_size);
+            if(arr_file.data != NULL) arr_file.close();
+            else delete[] (const int *) arr_source;
+        }
+    }
+    vector<long> pages_per_node = numa_page_placement(arr, array_size * arr_element_size);
+
+    reduce_kernel = select_reduce_kernel(arr_type, isa);
+    int stream_threads = min(max_threads, topology.available_cpus());
+    double stream_bandwidth = (stream_mb > 0) ? stream_probe::measure(pool, stream_threads, stream_mb) : 0;
+    //every strategy reads the whole array MAX_SUM_REPEAT times per run
+    double bytes_per_run = (double) array_size * arr_element_size * MAX_SUM_REPEAT;
+
+    //the process workers are forked once everything they read is in place, while the thread workers are idle
+    //(and before the hogs start), the process strategies are left out if that fails
+    int no_of_sum_functions = MAX_FUNCTIONS;
+    process_shared_bytes = sizeof(process_shared_state) + max_threads * sizeof(padded_sum);
+    process_state = (process_shared_state *) shared_alloc(process_shared_bytes);
+    if(process_state != NULL) {
+        process_partial_sum = (padded_sum *) (process_state + 1);
+        init_process_state();
+        if(processes.start(max_threads)) {
+            no_of_sum_functions += MAX_PROCESS_FUNCTIONS;
+            if(!processes.pin(cpus.data(), cpus.size()))
+                cerr << "Could not pin every worker process to its cpu, continuing with the ones that could be pinned\n";
+        }
+    }
+    if(no_of_sum_functions == MAX_FUNCTIONS) cerr << "Could not fork the worker processes, skipping the process strategies\n";
+
+    hogs.start(no_of_hogs, cpus.data(), cpus.size());
+
+    for(auto schedule : schedule_list) {
+        for(auto granularity : granularity_list) {
+            for(auto work : cs_work_list) {
+
+                grid.push_back(grid_point());
+                grid_point &point = grid.back();
+                point.schedule = schedule;
+                point.granularity = sum_granularity = granularity;
+                point.cs_work = cs_work = work;
+                LOCK_STATS_SECTION("schedule=" + string(schedule_mode_names[schedule]) + " granularity=" + to_string(granularity)
+                                   + " cs_work=" + to_string(work));
+
+                point.running_time.assign(no_of_sum_functions, vector<bench_stats>(thread_counts.size()));
+                point.counters_avg.assign(no_of_sum_functions, vector<perf_counts>(thread_counts.size()));
+                point.cpu_time.assign(no_of_sum_functions, vector<double>(thread_counts.size()));
+                for(int function_no = 0; function_no < no_of_sum_functions; function_no++) {
+
+                    for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+
+                        no_of_threads = thread_counts[count_no];
+                        perf_counts &counters = point.counters_avg[function_no][count_no];
+                        perf_clear(counters);
+                        //the counters follow the thread workers only, and the lock statistics stay in the processes
+                        bool in_process = (function_no >= MAX_FUNCTIONS);
+
+                        point.running_time[function_no][count_no] = bench_measure(bench, [&](bool warmup) {
+                        
+                            global_sum = global_rank = 0;
+                            atomic_sum = 0;
+                            for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
+                                thread_partial_sum[thread_no].value = 0;
+                            scheduler.prepare(schedule, array_size, MAX_SUM_REPEAT, schedule_chunk, no_of_threads);
+
+                            if(in_process) {
+                                reset_process_state(no_of_threads);
+                                double time_taken = processes.run(process_functions[function_no - MAX_FUNCTIONS], no_of_threads);
+                                if(!warmup) point.cpu_time[function_no][count_no] += processes.cpu_time;
+                                double reduce_start = thread_pool::wall_time();
+                                global_sum += process_state->sum + process_state->atomic_sum.load();
+                                return time_taken + thread_pool::wall_time() - reduce_start;
+                            }
+
+                            if(perf_enabled && !warmup) perf.start(no_of_threads);
+                            LOCK_STATS_BEGIN_RUN(no_of_threads);
+                            double cpu_start = process_cpu_time();
+                            double time_taken = pool.run(thread_functions[function_no], no_of_threads);
+                            if(!warmup) point.cpu_time[function_no][count_no] += process_cpu_time() - cpu_start;
+                            LOCK_STATS_END_RUN(thread_functions_name[function_no], no_of_threads, warmup);
+                            if(perf_enabled && !warmup) perf_accumulate(counters, perf.stop(no_of_threads), 1);
+
+                            //the lock-free strategies leave their result in atomic_sum or the padded slots,
+                            //folding them into global_sum is part of the strategy and is timed with it
+                            double reduce_start = thread_pool::wall_time();
+                            global_sum += atomic_sum.load();
+                            for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
+                                global_sum += thread_partial_sum[thread_no].value;
+                            return time_taken + thread_pool::wall_time() - reduce_start;
+                        });
+
+                        perf_scale(counters, 1.0 / point.running_time[function_no][count_no].samples.size());
+
+                        point.cpu_time[function_no][count_no] /= point.running_time[function_no][count_no].samples.size();
                     }
                 }
+            }
+        }
+    }
+
+    for(auto read_pct : read_pct_list) {
 
-                for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
-                    pthread_join(threads[thread_no], NULL);
-
-                gettimeofday(&end_time, NULL);
-                double time_taken;
-                time_taken = (end_time.tv_sec - start_time.tv_sec) * 1e6; 
-                time_taken = (time_taken + (end_time.tv_usec - start_time.tv_usec)) * 1e-6;
-                running_time_avg[function_no][no_of_threads - 1] += time_taken;
-                if(time_taken > running_time_max[function_no][no_of_threads - 1])
-                    running_time_max[function_no][no_of_threads - 1] = time_taken;
-                if(time_taken < running_time_min[function_no][no_of_threads - 1])
-                    running_time_min[function_no][no_of_threads - 1] = time_taken;
+        rw_mix.push_back(rw_mix_point());
+        rw_mix_point &point = rw_mix.back();
+        point.read_pct = read_pct;
+        LOCK_STATS_SECTION("read_pct=" + to_string(read_pct));
+        read_threshold = llround(read_pct * 100);
+
+        point.running_time.assign(MAX_RW_FUNCTIONS, vector<bench_stats>(thread_counts.size()));
+        point.counters_avg.assign(MAX_RW_FUNCTIONS, vector<perf_counts>(thread_counts.size()));
+        point.cpu_time.assign(MAX_RW_FUNCTIONS, vector<double>(thread_counts.size()));
+        for(int function_no = 0; function_no < MAX_RW_FUNCTIONS; function_no++) {
+
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+
+                no_of_threads = thread_counts[count_no];
+                perf_counts &counters = point.counters_avg[function_no][count_no];
+                perf_clear(counters);
+
+                point.running_time[function_no][count_no] = bench_measure(bench, [&](bool warmup) {
+
+                    for(int i = 0; i < RW_TABLE_SIZE; i++)
+                        rw_table[i] = reduce_kernel(arr, i % array_size, i % array_size + 1);
+
+                    if(perf_enabled && !warmup) perf.start(no_of_threads);
+                    LOCK_STATS_BEGIN_RUN(no_of_threads);
+                    double cpu_start = process_cpu_time();
+                    double time_taken = pool.run(rw_functions[function_no], no_of_threads);
+                    if(!warmup) point.cpu_time[function_no][count_no] += process_cpu_time() - cpu_start;
+                    LOCK_STATS_END_RUN(rw_functions_name[function_no], no_of_threads, warmup);
+                    if(perf_enabled && !warmup) perf_accumulate(counters, perf.stop(no_of_threads), 1);
+                    return time_taken;
+                });
+
+                perf_scale(counters, 1.0 / point.running_time[function_no][count_no].samples.size());
+
+                point.cpu_time[function_no][count_no] /= point.running_time[function_no][count_no].samples.size();
             }
+        }
+    }
+
+    //the output has the placement and pages of the array, with first touch its pages go where the first run writes them
+    scan_kernel = select_scan_kernel(arr_type);
+    if(!scan_list.empty() && !scan_buffer.allocate(array_size * sizeof(long long), placement, pages)) {
+        cerr << "Could not allocate the prefix sums, skipping them\n";
+        scan_list.clear();
+    }
+    scan_out = (long long *) scan_buffer.data;
+    //the slice totals are read twice, the prefix sums written once
+    double scan_bytes_per_run = (double) array_size * (2 * arr_element_size + sizeof(long long)) * MAX_SUM_REPEAT;
+
+    for(auto inclusive : scan_list) {
+
+        scans.push_back(scan_point());
+        scan_point &point = scans.back();
+        point.inclusive = scan_inclusive = inclusive;
+        LOCK_STATS_SECTION(string("scan=") + (inclusive ? "inclusive" : "exclusive"));
+        point.no_of_mismatches = 0;
+        long long expected_checksum = serial_scan_checksum();
+
+        point.running_time.assign(MAX_SCAN_FUNCTIONS, vector<bench_stats>(thread_counts.size()));
+        point.counters_avg.assign(MAX_SCAN_FUNCTIONS, vector<perf_counts>(thread_counts.size()));
+        point.cpu_time.assign(MAX_SCAN_FUNCTIONS, vector<double>(thread_counts.size()));
+        for(int function_no = 0; function_no < MAX_SCAN_FUNCTIONS; function_no++) {
+
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+
+                no_of_threads = thread_counts[count_no];
+                perf_counts &counters = point.counters_avg[function_no][count_no];
+                perf_clear(counters);
+
+                point.running_time[function_no][count_no] = bench_measure(bench, [&](bool warmup) {
+
+                    scan_posix_barrier.reset(no_of_threads);
+                    scan_condvar_barrier.reset(no_of_threads);
+                    scan_sense_barrier.reset(no_of_threads);
+                    scan_std_barrier.reset(no_of_threads);
+                    scan_futex_barrier.reset(no_of_threads);
+
+                    if(perf_enabled && !warmup) perf.start(no_of_threads);
+                    LOCK_STATS_BEGIN_RUN(no_of_threads);
+                    double cpu_start = process_cpu_time();
+                    double time_taken = pool.run(scan_functions[function_no], no_of_threads);
+                    if(!warmup) point.cpu_time[function_no][count_no] += process_cpu_time() - cpu_start;
+                    LOCK_STATS_END_RUN(scan_functions_name[function_no], no_of_threads, warmup);
+                    if(perf_enabled && !warmup) perf_accumulate(counters, perf.stop(no_of_threads), 1);
+                    return time_taken;
+                });
 
-            running_time_avg[function_no][no_of_threads - 1] /= MAX_REPEAT;
+                perf_scale(counters, 1.0 / point.running_time[function_no][count_no].samples.size());
 
+                point.cpu_time[function_no][count_no] /= point.running_time[function_no][count_no].samples.size();
+                point.no_of_mismatches += (scan_checksum() != expected_checksum);
+            }
         }
     }
 
-    if(argc != 1) cout << "For " << argv[1] << "\n";
+    hogs.stop();
+
+    if(input_file != NULL) cout << "For " << input_file << "\n";
     cout << "\nThe sum of the array is: " << global_sum << "\n";
-    cout << "The size of the array is: " << array_size << "\n\n";
+    cout << "The size of the array is: " << array_size << "\n";
+    cout << "Available cpus: " << topology.available_cpus() << " (" << topology.slots.size() << " hardware threads on "
+         << topology.no_of_cores << " cores in " << topology.no_of_packages << " packages";
+    if(topology.cgroup_limit > 0) cout << ", cgroup limit " << topology.cgroup_limit;
+    cout << "), affinity policy: " << affinity_policy_names[affinity] << "\n";
+    cout << "Array placement: " << numa_placement_names[placement] << ", pages: " << page_kind_names[arr_buffer.used_pages];
+    if(arr_buffer.used_pages != pages) cout << " (no reserved huge pages, " << page_kind_names[pages] << " requested)";
+    cout << ", sampled pages per node:";
+    for(size_t node = 0; node + 1 < pages_per_node.size(); node++)
+        cout << " node" << node << " " << pages_per_node[node];
+    if(pages_per_node.back() > 0) cout << " unknown " << pages_per_node.back();
+    cout << "\n";
+    cout << "Reduction kernel: " << simd_isa_names[isa] << " on " << element_type_name(arr_type) << " elements (widest supported: "
+         << simd_isa_names[widest_isa] << ")\n";
+    if(stream_bandwidth > 0)
+        cout << "STREAM triad bandwidth with " << stream_threads << " threads on " << stream_mb << " MB arrays: "
+             << setprecision(2) << stream_bandwidth / 1e9 << " GB/s\n";
+    if(cost_skew > 0 || no_of_hogs > 0)
+        cout << "Injected imbalance: " << defaultfloat << cost_skew << " units of work on the last element, " << no_of_hogs
+             << " background spinning threads\n" << fixed;
+    cout << "Futex spin before sleeping: ";
+    if(futex_spin == FUTEX_SPIN_ADAPTIVE) cout << "adaptive (mutex estimate " << sum_futex_mutex.spin.estimate << " rounds, barrier "
+                                               << scan_futex_barrier.spin.estimate << " rounds at the end)\n";
+    else cout << futex_spin << " rounds\n";
+    cout << "Thread startup time for " << max_threads << " threads (not included below): " << fixed << setprecision(6)
+         << pool.startup_time << " (" << pool.startup_time / max_threads << " per thread)\n";
+    if(processes.no_of_workers > 0)
+        cout << "Process startup time for " << max_threads << " forked processes (not included below): " << processes.startup_time
+             << " (" << processes.startup_time / max_threads << " per process)\n";
+    cout << "Warmup runs: " << bench.warmup_runs << ", measured runs: " << bench.min_repeat << " to " << bench.max_repeat
+         << " until the 95% confidence interval is within " << setprecision(1) << bench.target_ci * 100 << "% of the average\n\n";
     
-    double (*running_time[3])[10] = { running_time_avg, running_time_max, running_time_min };
-    string str[3] = { "average", "maximum", "minimum"};
-    for(int i = 0; i < 3; i++) {
-        cout << "The " << str[i] << " time spent for computing the array sum (in order of thread no from 1 to " << MAX_THREADS << "):\n";
-        for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
-            cout << thread_functions_name[function_no] << " :\n\t";
-            for(int no_of_threads = 0; no_of_threads < MAX_THREADS; no_of_threads++)
-                cout << setw(10) << fixed << setprecision(5) << running_time[i][function_no][no_of_threads] << "\t";
-            cout << "\n\n";
-        }
+    for(auto &point : grid) {
+        cout << "Schedule: " << schedule_mode_names[point.schedule];
+        if(point.schedule != SCHEDULE_STATIC) cout << " (chunks of " << schedule_chunk << " elements)";
+        cout << ", elements per lock acquisition: ";
+        if(point.granularity == 0) cout << "whole chunk";
+        else cout << point.granularity;
+        cout << ", work inside the critical section: " << point.cs_work << "\n\n";
+
+        print_stats("computing the array sum", thread_functions_name, point.running_time);
+        print_bandwidth(thread_functions_name, point.running_time, bytes_per_run, stream_bandwidth);
+        print_cpu_time(thread_functions_name, point.running_time, point.cpu_time);
+        if(perf_enabled) print_counters(thread_functions_name, point.counters_avg, MAX_FUNCTIONS);
+    }
+
+    for(auto &point : rw_mix) {
+        cout << "Read-write lock lookup table with " << defaultfloat << point.read_pct << "% reads\n\n";
+
+        print_stats("the lookups", rw_functions_name, point.running_time);
+        print_cpu_time(rw_functions_name, point.running_time, point.cpu_time);
+        if(perf_enabled) print_counters(rw_functions_name, point.counters_avg);
     }
     
 
-    ofstream fout("data.txt");
-    if(fout.is_open()) {
-
-        if(argc == 1) fout << "Console input\n";
-        else fout << argv[1] << "\n";
-        fout << global_sum << "\n" << array_size << "\n";
-        fout << MAX_FUNCTIONS << "\n" << MAX_THREADS << "\n";
-        for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
-            fout << thread_functions_name[function_no] << "\n";
-            for(int ty = 0; ty < 3; ty++) {
-                for(int no_of_threads = 0; no_of_threads < MAX_THREADS; no_of_threads++)
-                    fout << setw(10) << setprecision(5) << running_time[ty][function_no][no_of_threads] << "\n";
-            }
+    for(auto &point : scans) {
+        cout << "Prefix sums (" << (point.inclusive ? "inclusive" : "exclusive") << " scan in three phases separated by barriers)";
+        if(point.no_of_mismatches > 0) cout << ", " << point.no_of_mismatches << " runs DIFFER from the serial scan";
+        cout << "\n\n";
+
+        print_stats("the prefix sums", scan_functions_name, point.running_time);
+        print_bandwidth(scan_functions_name, point.running_time, scan_bytes_per_run, stream_bandwidth);
+        print_cpu_time(scan_functions_name, point.running_time, point.cpu_time);
+        if(perf_enabled) print_counters(scan_functions_name, point.counters_avg);
+    }
+
+    LOCK_STATS_PRINT_SUMMARY();
+
+
+    result_set results;
+    results.program = "array_sum";
+    results.input = (input_file == NULL) ? "console" : input_file;
+    results.problem_size = array_size;
+    results.host.collect();
+    for(auto &point : grid) {
+        string experiment = "granularity=" + to_string(point.granularity) + " cs_work=" + to_string(point.cs_work)
+                            + " affinity=" + affinity_policy_names[affinity] + " placement=" + numa_placement_names[placement]
+                            + " pages=" + page_kind_names[pages] + " schedule=" + schedule_mode_names[point.schedule];
+        if(point.schedule != SCHEDULE_STATIC) experiment += " chunk=" + to_string(schedule_chunk);
+        if(cost_skew > 0) {
+            ostringstream skew;
+            skew << cost_skew;
+            experiment += " skew=" + skew.str();
         }
-        fout.close();
-    } else {
-        cerr << "Error writing output to file\n.Terminating program........";
+        if(no_of_hogs > 0) experiment += " hogs=" + to_string(no_of_hogs);
+        for(int function_no = 0; function_no < no_of_sum_functions; function_no++)
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+                results.add(experiment, thread_functions_name[function_no], thread_counts[count_no], point.running_time[function_no][count_no],
+                            (perf_enabled && function_no < MAX_FUNCTIONS) ? &point.counters_avg[function_no][count_no] : NULL,
+                            bytes_per_run);
+    }
+    for(auto &point : rw_mix) {
+        ostringstream experiment;
+        experiment << "read_pct=" << point.read_pct << " affinity=" << affinity_policy_names[affinity];
+        for(int function_no = 0; function_no < MAX_RW_FUNCTIONS; function_no++)
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+                results.add(experiment.str(), rw_functions_name[function_no], thread_counts[count_no], point.running_time[function_no][count_no],
+                            perf_enabled ? &point.counters_avg[function_no][count_no] : NULL);
+    }
+    for(auto &point : scans) {
+        string experiment = string("scan=") + (point.inclusive ? "inclusive" : "exclusive") + " affinity=" + affinity_policy_names[affinity]
+                            + " placement=" + numa_placement_names[placement] + " pages=" + page_kind_names[pages];
+        for(int function_no = 0; function_no < MAX_SCAN_FUNCTIONS; function_no++)
+            for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+                results.add(experiment, scan_functions_name[function_no], thread_counts[count_no], point.running_time[function_no][count_no],
+                            perf_enabled ? &point.counters_avg[function_no][count_no] : NULL, scan_bytes_per_run);
+    }
+    results.compute_speedup();
+
+    if(!results.write(output.output))
+        cerr << "Error writing the results to " << output.output << "\n";
+    int no_of_regressions = 0;
+    if(!output.baseline.empty()) {
+        no_of_regressions = compare_with_baseline(results, output.baseline, output.threshold);
+        if(no_of_regressions < 0) cerr << "Could not read the baseline " << output.baseline << "\n";
     }
 
 
-    delete[] arr;
+    if(perf_enabled) perf.close();
+    pool.stop();
+    processes.stop();
+    if(process_state != NULL) destroy_process_state();
+    free_array();
+    scan_buffer.release();
+    delete[] thread_partial_sum;
     pthread_mutex_destroy(&sum_mutex);
     sem_destroy(&sum_semaphore);
 
-    return 0;
+    return (no_of_regressions > 0) ? 1 : 0;
 }
\ No newline at end of file
@@ -1,20 +1,203 @@
 #include<bits/stdc++.h>
+#include<getopt.h>
+#include "../common/binary_array.h"
+#include "../common/bench_harness.h"
 #define MAX_INPUT_FILES 5
+#define MAX_GENERATOR_THREADS 64
+#define CHUNK_ELEMENTS (1 << 20)
 using namespace std;
 
-int main() {
-
-    int array_size = 100000;
-    srand(time(0));
-    
-    for(int input_file_no = 1; input_file_no <= MAX_INPUT_FILES; input_file_no++) {
-        const char * input_file_name = ("input" + to_string(input_file_no) + ".txt").c_str();
-        freopen(input_file_name, "w", stdout);
-        cout << array_size << "\n";
-        for(int i = 0; i < array_size; i++)
-            cout << (rand() % 200 - 100) << "\n";
-        array_size *= 5;
+//settings for the binary files
+uint32_t element_type = ELEMENT_INT32;
+uint64_t seed, no_of_elements;
+int no_of_threads;
+int fd;
+atomic<uint64_t> next_chunk, checksum;
+atomic<bool> write_failed;
+
+//value of element i, the same range as the text files ([-100, 100))
+static inline long long element_value(uint64_t index) {
+    return (long long) (counter_rng(seed, index) % 200) - 100;
+}
+
+template<class T>
+void fill_chunk(T *buffer, uint64_t first, uint64_t count) {
+    for(uint64_t i = 0; i < count; i++)
+        buffer[i] = (T) element_value(first + i);
+}
+
+//every thread repeatedly claims the next chunk of CHUNK_ELEMENTS elements, generates it into its own
+//buffer, adds the chunk to the checksum and writes it at its final position with pwrite
+void write_chunks() {
+
+    size_t elem_size = element_size(element_type);
+    vector<uint64_t> buffer(CHUNK_ELEMENTS * elem_size / 8 + 1);
+    uint64_t no_of_chunks = (no_of_elements + CHUNK_ELEMENTS - 1) / CHUNK_ELEMENTS;
+    uint64_t my_checksum = 0;
+
+    for(uint64_t chunk_no = next_chunk++; chunk_no < no_of_chunks && !write_failed; chunk_no = next_chunk++) {
+        uint64_t first = chunk_no * CHUNK_ELEMENTS;
+        uint64_t count = min((uint64_t) CHUNK_ELEMENTS, no_of_elements - first);
+        switch(element_type) {
+            case ELEMENT_INT8: fill_chunk((int8_t *) buffer.data(), first, count); break;
+            case ELEMENT_INT16: fill_chunk((int16_t *) buffer.data(), first, count); break;
+            case ELEMENT_INT32: fill_chunk((int32_t *) buffer.data(), first, count); break;
+            case ELEMENT_INT64: fill_chunk((int64_t *) buffer.data(), first, count); break;
+            case ELEMENT_FLOAT: fill_chunk((float *) buffer.data(), first, count); break;
+            case ELEMENT_DOUBLE: fill_chunk((double *) buffer.data(), first, count); break;
+        }
+
+        //CHUNK_ELEMENTS * elem_size is a multiple of 8, so every chunk starts on a checksum word
+        size_t bytes = count * elem_size;
+        uint64_t first_word = first * elem_size / 8;
+        my_checksum += checksum_words(buffer.data(), bytes / 8, first_word);
+        my_checksum += checksum_tail((char *) buffer.data() + bytes / 8 * 8, bytes % 8, first_word + bytes / 8);
+
+        const char *p = (const char *) buffer.data();
+        off_t offset = BINARY_ARRAY_DATA_OFFSET + first * elem_size;
+        while(bytes > 0) {
+            ssize_t written = pwrite(fd, p, bytes, offset);
+            if(written <= 0) {
+                write_failed = true;
+                break;
+            }
+            p += written;
+            offset += written;
+            bytes -= written;
+        }
     }
-    
+
+    checksum += my_checksum;
+}
+
+bool write_binary_file(const string &file_name) {
+
+    fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+    if(ftruncate(fd, BINARY_ARRAY_DATA_OFFSET + no_of_elements * element_size(element_type)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    next_chunk = 0;
+    checksum = 0;
+    write_failed = false;
+    pthread_t threads[MAX_GENERATOR_THREADS];
+    int no_of_created = 0;
+    for(int thread_no = 1; thread_no < no_of_threads; thread_no++)
+        if(pthread_create(&threads[no_of_created], NULL, [](void *) -> void* { write_chunks(); return NULL; }, NULL) == 0)
+            no_of_created++;
+    write_chunks();
+    for(int thread_no = 0; thread_no < no_of_created; thread_no++)
+        pthread_join(threads[thread_no], NULL);
+
+    binary_array_header header;
+    binary_array_init_header(header, element_type, no_of_elements);
+    header.checksum = checksum;
+    bool ok = !write_failed && pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    return close(fd) == 0 && ok;
+}
+
+void usage(const char *program_name) {
+    cerr << "Usage: " << program_name << " [-b] [-n elements] [-o file] [-s seed] [-t threads] [-e type]\n"
+         << "\tWithout -b the text files input1.txt to input" << MAX_INPUT_FILES << ".txt are written.\n"
+         << "\t-b writes binary files instead (input1.bin to input" << MAX_INPUT_FILES << ".bin with the same sizes),\n"
+         << "\t   or a single file of -n elements named by -o (default input.bin).\n"
+         << "\t-s seed (default random), -t generator threads (default all cores),\n"
+         << "\t-e element type: int8, int16, int32 (default), int64, float or double.\n";
+}
+
+int main(int argc, char **argv) {
+
+    bool binary = false;
+    string output_file = "input.bin";
+    seed = random_device()();
+    no_of_elements = 0;
+    no_of_threads = min(sysconf(_SC_NPROCESSORS_ONLN), (long) MAX_GENERATOR_THREADS);
+
+    int option;
+    char *end;
+    long long elements;
+    long threads;
+    int type_no;
+    while((option = getopt(argc, argv, "bn:o:s:t:e:h")) != -1) {
+        switch(option) {
+            case 'b': binary = true; break;
+            case 'n':
+                elements = strtoll(optarg, &end, 10);
+                if(*end != '\0' || elements <= 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                no_of_elements = elements;
+                break;
+            case 'o': output_file = optarg; break;
+            case 's':
+                seed = strtoull(optarg, &end, 10);
+                if(end == optarg || *end != '\0' || optarg[0] == '-') {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                threads = strtol(optarg, &end, 10);
+                if(*end != '\0' || threads <= 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                no_of_threads = min(threads, (long) MAX_GENERATOR_THREADS);
+                break;
+            case 'e':
+                if(!parse_enum_name(optarg, element_type_names + ELEMENT_INT8, ELEMENT_DOUBLE, type_no)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                element_type = ELEMENT_INT8 + type_no;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(!binary) {
+        int array_size = 100000;
+        srand(seed);
+
+        for(int input_file_no = 1; input_file_no <= MAX_INPUT_FILES; input_file_no++) {
+            string input_file_name = "input" + to_string(input_file_no) + ".txt";
+            ofstream fout(input_file_name);
+            fout << array_size << "\n";
+            for(int i = 0; i < array_size; i++)
+                fout << (rand() % 200 - 100) << "\n";
+            array_size *= 5;
+        }
+
+        return 0;
+    }
+
+    vector<pair<string, uint64_t>> files;
+    if(no_of_elements > 0) {
+        files.push_back({output_file, no_of_elements});
+    } else {
+        uint64_t array_size = 100000;
+        for(int input_file_no = 1; input_file_no <= MAX_INPUT_FILES; input_file_no++, array_size *= 5)
+            files.push_back({"input" + to_string(input_file_no) + ".bin", array_size});
+    }
+
+    for(auto &file : files) {
+        no_of_elements = file.second;
+        auto start_time = chrono::steady_clock::now();
+        if(!write_binary_file(file.first)) {
+            cerr << "Error writing " << file.first << ".\nTerminating program........\n";
+            return 1;
+        }
+        double time_taken = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        double megabytes = no_of_elements * element_size(element_type) / (double) (1 << 20);
+        cout << file.first << ": " << no_of_elements << " " << element_type_name(element_type) << " elements, seed " << seed
+             << ", " << fixed << setprecision(2) << megabytes << " MB in " << setprecision(3) << time_taken << " seconds ("
+             << setprecision(2) << megabytes / time_taken << " MB/s)\n";
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,54 +1,61 @@
+import csv
+import sys
+from collections import OrderedDict
+
 import matplotlib.pyplot as plt
 
-input_file_name = input().split(".")[0]
-global_sum = int(input())
-array_size = int(input())
-MAX_FUNCTIONS = int(input())
-MAX_THREADS = int(input())
+results_file_name = sys.argv[1] if len(sys.argv) > 1 else "results.csv"
+with open(results_file_name) as results_file:
+    records = list(csv.DictReader(results_file))
 
-colors = ['b', 'g', 'r', 'c', 'm', 'y', 'k']
+input_file_name = records[0]["input"].split("/")[-1].split(".")[0]
+array_size = records[0]["problem_size"]
 
-plt.figure(1)
-plt.figure(2)
-plt.figure(3)
-
-for function_no in range(MAX_FUNCTIONS):
-    function_name = input()
-    avg_running_time = []
-    max_running_time = []
-    min_running_time = []
-    for thread_no in range(MAX_THREADS):
-        avg_running_time.append(float(input()))
-    for thread_no in range(MAX_THREADS):
-        max_running_time.append(float(input()))
-    for thread_no in range(MAX_THREADS):
-        min_running_time.append(float(input()))
-    plt.figure(1)
-    plt.plot(range(1, MAX_THREADS + 1), avg_running_time, colors[function_no], label=function_name)
-    plt.figure(2)
-    plt.plot(range(1, MAX_THREADS + 1), max_running_time, colors[function_no], label=function_name)
-    plt.figure(3)
-    plt.plot(range(1, MAX_THREADS + 1), min_running_time, colors[function_no], label=function_name)
-
-plt.figure(1)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ")" )
-plt.xlabel("No of threads")
-plt.ylabel("Average Running time (seconds)")
-plt.legend()
-plt.savefig(input_file_name + "_avg.png")
-
-plt.figure(2)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ")" )
-plt.xlabel("No of threads")
-plt.ylabel("Maximum Running time (seconds)")
-plt.legend()
-plt.savefig(input_file_name + "_max.png")
-
-plt.figure(3)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ")" )
-plt.xlabel("No of threads")
-plt.ylabel("Minimum Running time (seconds)")
-plt.legend()
-plt.savefig(input_file_name + "_min.png")
-
-plt.show()
\ No newline at end of file
+# times[experiment][strategy][threads] = the times of all repeats, in the order they were run
+times = OrderedDict()
+for record in records:
+    strategies = times.setdefault(record["experiment"], OrderedDict())
+    strategies.setdefault(record["strategy"], OrderedDict()).setdefault(int(record["threads"]), []).append(float(record["time"]))
+
+colors = ['b', 'g', 'r', 'c', 'm', 'y', 'k']
+line_styles = ['-', '--', ':']
+figure_no = 0
+
+
+# plots the average, maximum and minimum time and the speedup of every strategy of one experiment
+def plot_experiment(experiment, strategies, suffix):
+    global figure_no
+    kinds = [("Average", "avg", lambda samples: sum(samples) / len(samples)),
+             ("Maximum", "max", max),
+             ("Minimum", "min", min)]
+    figures = [figure_no + 1, figure_no + 2, figure_no + 3, figure_no + 4]
+    figure_no += 4
+    y_label = "lookup time (seconds)" if experiment.startswith("read_pct") else "Running time (seconds)"
+
+    for function_no, (function_name, samples) in enumerate(strategies.items()):
+        style = colors[function_no % len(colors)] + line_styles[function_no // len(colors) % len(line_styles)]
+        threads = list(samples.keys())
+        for figure, (kind, short_kind, reduce) in zip(figures, kinds):
+            plt.figure(figure)
+            plt.plot(threads, [reduce(samples[thread]) for thread in threads], style, label=function_name)
+        average = [sum(samples[thread]) / len(samples[thread]) for thread in threads]
+        if 1 in samples:
+            plt.figure(figures[3])
+            plt.plot(threads, [average[0] / value for value in average], style, label=function_name)
+
+    title = input_file_name + "  (array size = " + array_size + ", " + experiment + ")"
+    labels = [(kind + " " + y_label, short_kind) for kind, short_kind, reduce in kinds] + [("Speedup over 1 thread", "speedup")]
+    for figure, (label, short_kind) in zip(figures, labels):
+        plt.figure(figure)
+        plt.title(title)
+        plt.xlabel("No of threads")
+        plt.ylabel(label)
+        plt.legend()
+        plt.savefig(input_file_name + suffix + "_" + short_kind + ".png")
+
+
+for experiment, strategies in times.items():
+    suffix = "" if len(times) == 1 else "_" + experiment.replace("=", "").replace(" ", "_")
+    plot_experiment(experiment, strategies, suffix)
+
+plt.show()
@@ -0,0 +1,115 @@
+#ifndef BARRIERS_H
+#define BARRIERS_H
+
+#include<pthread.h>
+#include<atomic>
+#include<memory>
+#include<vector>
+#include<barrier>
+#include "spinlock.h"
+
+//barriers behind one interface: reset(no_of_threads) is called while nobody waits (before every run, the
+//number of threads changes over a sweep) and wait(my_rank) returns once all no_of_threads ranks called it
+
+struct posix_barrier {
+    pthread_barrier_t barrier;
+    bool initialised = false;
+
+    ~posix_barrier() {
+        if(initialised) pthread_barrier_destroy(&barrier);
+    }
+
+    void reset(int no_of_threads) {
+        if(initialised) pthread_barrier_destroy(&barrier);
+        pthread_barrier_init(&barrier, NULL, no_of_threads);
+        initialised = true;
+    }
+
+    void wait(int) {
+        pthread_barrier_wait(&barrier);
+    }
+};
+
+//the last thread to arrive starts a new cycle and wakes the others, who wait for the cycle to change
+//rather than for the count, so a spurious wakeup or an early arrival at the next barrier does no harm
+struct condvar_barrier {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int no_of_threads = 1, count = 0;
+    unsigned long cycle = 0;
+
+    condvar_barrier() {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+    }
+
+    ~condvar_barrier() {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+    }
+
+    void reset(int threads) {
+        no_of_threads = threads;
+        count = 0;
+    }
+
+    void wait(int) {
+        pthread_mutex_lock(&mutex);
+        unsigned long my_cycle = cycle;
+        if(++count == no_of_threads) {
+            count = 0;
+            cycle++;
+            pthread_cond_broadcast(&cond);
+        } else {
+            while(cycle == my_cycle)
+                pthread_cond_wait(&cond, &mutex);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+//centralised spin barrier: every rank flips its own sense, the last one to arrive resets the count and
+//publishes the new sense, the others spin on it (reading only, so the line is shared until then)
+struct sense_reversing_barrier {
+    struct alignas(SPINLOCK_CACHE_LINE) local_sense {
+        bool sense;
+    };
+
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<int> count{0};
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<bool> sense{false};
+    int no_of_threads = 1;
+    std::vector<local_sense> local;
+
+    void reset(int threads) {
+        no_of_threads = threads;
+        count = 0;
+        sense = false;
+        local.assign(threads, local_sense{false});
+    }
+
+    void wait(int my_rank) {
+        bool my_sense = local[my_rank].sense = !local[my_rank].sense;
+        if(count.fetch_add(1, std::memory_order_acq_rel) == no_of_threads - 1) {
+            count.store(0, std::memory_order_relaxed);
+            sense.store(my_sense, std::memory_order_release);
+        } else {
+            while(sense.load(std::memory_order_acquire) != my_sense)
+                cpu_relax();
+        }
+    }
+};
+
+//std::barrier has its count fixed at construction, so a reset builds a new one
+struct std_barrier {
+    std::unique_ptr<std::barrier<>> barrier;
+
+    void reset(int no_of_threads) {
+        barrier = std::make_unique<std::barrier<>>(no_of_threads);
+    }
+
+    void wait(int) {
+        barrier->arrive_and_wait();
+    }
+};
+
+#endif
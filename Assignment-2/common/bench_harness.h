@@ -0,0 +1,188 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include<getopt.h>
+#include<time.h>
+#include<cmath>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<vector>
+#include<algorithm>
+
+#define BENCH_WARMUP_RUNS 1
+#define BENCH_MIN_REPEAT 5
+#define BENCH_MAX_REPEAT 30
+#define BENCH_TARGET_CI 0.05
+#define BENCH_OUTLIER_IQR 1.5
+
+//monotonic clock that is not slewed by NTP, in seconds
+static inline double monotonic_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//the same clock in integer nanoseconds, for timestamps whose differences must not lose precision
+static inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//cpu time used by all threads of the process, in seconds, compared with the wall time it shows how much
+//of a run was spent spinning rather than sleeping
+static inline double process_cpu_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct bench_config {
+    int warmup_runs = BENCH_WARMUP_RUNS;
+    int min_repeat = BENCH_MIN_REPEAT;
+    int max_repeat = BENCH_MAX_REPEAT;
+    //stop once the 95% confidence interval of the mean is within this fraction of the mean
+    double target_ci = BENCH_TARGET_CI;
+};
+
+struct bench_stats {
+    std::vector<double> samples;
+    std::vector<bool> outlier;
+    double mean = 0, stddev = 0, min = 0, max = 0;
+    double median = 0, p90 = 0, p99 = 0;
+    double ci_half_width = 0;
+    int no_of_outliers = 0;
+    bool converged = false;
+};
+
+//two sided 95% critical values of Student's t distribution for 1 to 30 degrees of freedom
+static inline double t_critical_95(int degrees_of_freedom) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if(degrees_of_freedom < 1) return INFINITY;
+    if(degrees_of_freedom <= 30) return table[degrees_of_freedom - 1];
+    return 1.96;
+}
+
+//percentile (0 to 100) of sorted values with linear interpolation between the closest ranks
+static inline double percentile(const std::vector<double> &sorted, double pct) {
+    if(sorted.empty()) return 0;
+    double rank = pct / 100 * (sorted.size() - 1);
+    size_t low = (size_t) rank;
+    size_t high = std::min(low + 1, sorted.size() - 1);
+    return sorted[low] + (sorted[high] - sorted[low]) * (rank - low);
+}
+
+//recomputes every statistic from the samples, a sample is flagged as an outlier if it lies more than
+//BENCH_OUTLIER_IQR inter-quartile ranges outside the quartiles
+static inline void bench_update_stats(bench_stats &stats) {
+    size_t n = stats.samples.size();
+    if(n == 0) return;
+    std::vector<double> sorted(stats.samples);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for(double sample : sorted) sum += sample;
+    stats.mean = sum / n;
+    double square_sum = 0;
+    for(double sample : sorted) square_sum += (sample - stats.mean) * (sample - stats.mean);
+    stats.stddev = (n > 1) ? sqrt(square_sum / (n - 1)) : 0;
+    stats.ci_half_width = (n > 1) ? t_critical_95(n - 1) * stats.stddev / sqrt((double) n) : INFINITY;
+
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.median = percentile(sorted, 50);
+    stats.p90 = percentile(sorted, 90);
+    stats.p99 = percentile(sorted, 99);
+
+    double q1 = percentile(sorted, 25), q3 = percentile(sorted, 75);
+    double low_fence = q1 - BENCH_OUTLIER_IQR * (q3 - q1), high_fence = q3 + BENCH_OUTLIER_IQR * (q3 - q1);
+    stats.outlier.assign(n, false);
+    stats.no_of_outliers = 0;
+    for(size_t i = 0; i < n; i++) {
+        if(stats.samples[i] < low_fence || stats.samples[i] > high_fence) {
+            stats.outlier[i] = true;
+            stats.no_of_outliers++;
+        }
+    }
+}
+
+//runs run_once(true) warmup_runs times and then run_once(false) until the confidence interval is tight
+//enough (after at least min_repeat runs) or max_repeat runs are done, run_once returns the time of one run
+template<class Run>
+bench_stats bench_measure(const bench_config &config, Run run_once) {
+    bench_stats stats;
+    for(int run_no = 0; run_no < config.warmup_runs; run_no++)
+        run_once(true);
+
+    while((int) stats.samples.size() < config.max_repeat) {
+        stats.samples.push_back(run_once(false));
+        if((int) stats.samples.size() < config.min_repeat) continue;
+        bench_update_stats(stats);
+        if(stats.ci_half_width <= config.target_ci * stats.mean) {
+            stats.converged = true;
+            break;
+        }
+    }
+    bench_update_stats(stats);
+
+    return stats;
+}
+
+//command line options shared by the benchmarks, to be placed in their getopt_long option tables
+enum {
+    BENCH_OPTION_WARMUP = 1000,
+    BENCH_OPTION_MIN_REPEAT,
+    BENCH_OPTION_MAX_REPEAT,
+    BENCH_OPTION_TARGET_CI
+};
+
+#define BENCH_LONG_OPTIONS \
+    {"warmup", required_argument, NULL, BENCH_OPTION_WARMUP}, \
+    {"min-repeat", required_argument, NULL, BENCH_OPTION_MIN_REPEAT}, \
+    {"max-repeat", required_argument, NULL, BENCH_OPTION_MAX_REPEAT}, \
+    {"ci", required_argument, NULL, BENCH_OPTION_TARGET_CI}
+
+#define BENCH_USAGE \
+    "\t--warmup N\t\tunmeasured runs before every measurement (default 1)\n" \
+    "\t--min-repeat N\t\tmeasured runs before the confidence interval is checked (default 5)\n" \
+    "\t--max-repeat N\t\tmeasured runs at most (default 30)\n" \
+    "\t--ci PCT\t\tstop once the 95% confidence interval is within PCT percent of the mean (default 5)\n"
+
+//returns false if the option is not one of the harness options or its value is invalid
+static inline bool bench_parse_option(int option, const char *arg, bench_config &config) {
+    char *end;
+    switch(option) {
+        case BENCH_OPTION_WARMUP:
+            config.warmup_runs = strtol(arg, &end, 10);
+            return *end == '\0' && config.warmup_runs >= 0;
+        case BENCH_OPTION_MIN_REPEAT:
+            config.min_repeat = strtol(arg, &end, 10);
+            config.max_repeat = std::max(config.max_repeat, config.min_repeat);
+            return *end == '\0' && config.min_repeat >= 2;
+        case BENCH_OPTION_MAX_REPEAT:
+            config.max_repeat = strtol(arg, &end, 10);
+            config.min_repeat = std::min(config.max_repeat, config.min_repeat);
+            return *end == '\0' && config.max_repeat >= 2;
+        case BENCH_OPTION_TARGET_CI:
+            config.target_ci = strtod(arg, &end) / 100;
+            return *end == '\0' && config.target_ci > 0;
+    }
+    return false;
+}
+
+//an option value given by name: value becomes the index of str in names, false if it is none of them
+template<class Enum>
+static inline bool parse_enum_name(const char *str, const char **names, int no_of_names, Enum &value) {
+    for(int name_no = 0; name_no < no_of_names; name_no++) {
+        if(strcmp(str, names[name_no]) == 0) {
+            value = (Enum) name_no;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef BINARY_ARRAY_H
+#define BINARY_ARRAY_H
+
+#include<pthread.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<cstdint>
+#include<cstring>
+#include<algorithm>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary array files are stored little-endian, add byte swapping before building on this host"
+#endif
+
+//layout of a binary array file: a 64 byte header followed by count raw little-endian elements
+//starting at data_offset, the checksum covers the data section read as 64 bit words (zero padded)
+#define BINARY_ARRAY_MAGIC "PPARRAY"
+#define BINARY_ARRAY_VERSION 1
+#define BINARY_ARRAY_DATA_OFFSET 64
+#define BINARY_ARRAY_MAX_THREADS 64
+
+enum element_type_t {
+    ELEMENT_INT8 = 1,
+    ELEMENT_INT16 = 2,
+    ELEMENT_INT32 = 3,
+    ELEMENT_INT64 = 4,
+    ELEMENT_FLOAT = 5,
+    ELEMENT_DOUBLE = 6
+};
+
+struct binary_array_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t element_type;
+    uint64_t count;
+    uint64_t checksum;
+    uint64_t data_offset;
+    uint8_t reserved[24];
+};
+static_assert(sizeof(binary_array_header) == BINARY_ARRAY_DATA_OFFSET, "binary array header must be 64 bytes");
+
+static inline size_t element_size(uint32_t element_type) {
+    switch(element_type) {
+        case ELEMENT_INT8: return 1;
+        case ELEMENT_INT16: return 2;
+        case ELEMENT_INT32: return 4;
+        case ELEMENT_INT64: return 8;
+        case ELEMENT_FLOAT: return 4;
+        case ELEMENT_DOUBLE: return 8;
+    }
+    return 0;
+}
+
+//indexed by element_type_t, 0 is not a type
+[[maybe_unused]] static const char* element_type_names[] = {"unknown", "int8", "int16", "int32", "int64", "float", "double"};
+
+static inline const char* element_type_name(uint32_t element_type) {
+    return (element_type <= ELEMENT_DOUBLE) ? element_type_names[element_type] : "unknown";
+}
+
+//splitmix64 finalizer, used both as the counter based generator (value i depends only on seed and i,
+//so any chunk can be produced independently) and for mixing the checksum words
+static inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t counter_rng(uint64_t seed, uint64_t index) {
+    return mix64(seed + (index + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+//checksum of 64 bit words first_word, first_word + 1, ... as a wrapping sum, so that partial sums of
+//disjoint chunks can be computed in parallel and simply added together
+static inline uint64_t checksum_words(const uint64_t *words, uint64_t no_of_words, uint64_t first_word) {
+    uint64_t checksum = 0;
+    for(uint64_t i = 0; i < no_of_words; i++)
+        checksum += mix64(words[i] ^ ((first_word + i) * 0x9E3779B97F4A7C15ULL));
+    return checksum;
+}
+
+static inline uint64_t checksum_tail(const void *tail, size_t bytes, uint64_t word_index) {
+    if(bytes == 0) return 0;
+    uint64_t word = 0;
+    memcpy(&word, tail, bytes);
+    return checksum_words(&word, 1, word_index);
+}
+
+struct checksum_chunk {
+    const uint64_t *words;
+    uint64_t no_of_words, first_word, checksum;
+};
+
+static void* checksum_chunk_thread(void *arg) {
+    checksum_chunk *c = (checksum_chunk *) arg;
+    c->checksum = checksum_words(c->words, c->no_of_words, c->first_word);
+    return NULL;
+}
+
+//checksum of a whole data section using the online cores
+static inline uint64_t binary_array_checksum(const void *data, uint64_t bytes) {
+    uint64_t no_of_words = bytes / 8;
+    int no_of_threads = (int) std::max(1L, std::min(sysconf(_SC_NPROCESSORS_ONLN), (long) BINARY_ARRAY_MAX_THREADS));
+    if(no_of_words < (1 << 20)) no_of_threads = 1;
+
+    checksum_chunk chunks[BINARY_ARRAY_MAX_THREADS];
+    pthread_t threads[BINARY_ARRAY_MAX_THREADS];
+    bool created[BINARY_ARRAY_MAX_THREADS];
+    uint64_t words_per_thread = (no_of_words + no_of_threads - 1) / no_of_threads;
+    for(int thread_no = 0; thread_no < no_of_threads; thread_no++) {
+        uint64_t first_word = std::min(no_of_words, words_per_thread * thread_no);
+        uint64_t last_word = std::min(no_of_words, first_word + words_per_thread);
+        chunks[thread_no] = {(const uint64_t *) data + first_word, last_word - first_word, first_word, 0};
+    }
+    for(int thread_no = 1; thread_no < no_of_threads; thread_no++)
+        created[thread_no] = (pthread_create(&threads[thread_no], NULL, checksum_chunk_thread, (void *) (&chunks[thread_no])) == 0);
+    checksum_chunk_thread((void *) (&chunks[0]));
+
+    uint64_t checksum = chunks[0].checksum;
+    for(int thread_no = 1; thread_no < no_of_threads; thread_no++) {
+        if(created[thread_no]) pthread_join(threads[thread_no], NULL);
+        else checksum_chunk_thread((void *) (&chunks[thread_no]));
+        checksum += chunks[thread_no].checksum;
+    }
+
+    return checksum + checksum_tail((const char *) data + no_of_words * 8, bytes % 8, no_of_words);
+}
+
+static inline void binary_array_init_header(binary_array_header &header, uint32_t element_type, uint64_t count) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_ARRAY_MAGIC, sizeof(BINARY_ARRAY_MAGIC));
+    header.version = BINARY_ARRAY_VERSION;
+    header.element_type = element_type;
+    header.count = count;
+    header.data_offset = BINARY_ARRAY_DATA_OFFSET;
+}
+
+enum binary_array_status_t {
+    BINARY_ARRAY_OK,
+    BINARY_ARRAY_NOT_BINARY,
+    BINARY_ARRAY_INVALID,
+    BINARY_ARRAY_BAD_CHECKSUM
+};
+
+//a read only mapping of a binary array file, data points straight at the elements
+struct binary_array_file {
+
+    int fd = -1;
+    void *mapping = NULL;
+    size_t size = 0;
+    binary_array_header header;
+    const void *data = NULL;
+
+    //returns BINARY_ARRAY_NOT_BINARY without mapping anything if the file does not start with the magic,
+    //so the caller can fall back to the text loader
+    //with map_data false only the header is validated and fd is left open for the caller to read the data
+    //(which then has to check the checksum itself), for files that do not fit in memory
+    int open(const char *file_name, bool map_data = true) {
+        fd = ::open(file_name, O_RDONLY);
+        if(fd < 0) return BINARY_ARRAY_NOT_BINARY;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(header)
+           || pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)
+           || memcmp(header.magic, BINARY_ARRAY_MAGIC, sizeof(BINARY_ARRAY_MAGIC)) != 0) {
+            close();
+            return BINARY_ARRAY_NOT_BINARY;
+        }
+
+        size = st.st_size;
+        //the data offset is checked against the size before anything is subtracted or multiplied, so that a
+        //corrupt header cannot wrap around into a size that matches
+        size_t esize = element_size(header.element_type);
+        if(header.version != BINARY_ARRAY_VERSION || esize == 0
+           || header.data_offset < sizeof(header) || header.data_offset % 64 != 0 || header.data_offset > size
+           || header.count > (size - header.data_offset) / esize
+           || header.count * esize != size - header.data_offset) {
+            close();
+            return BINARY_ARRAY_INVALID;
+        }
+        size_t bytes = header.count * esize;
+        if(!map_data) return BINARY_ARRAY_OK;
+
+        mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if(mapping == MAP_FAILED) {
+            mapping = NULL;
+            close();
+            return BINARY_ARRAY_INVALID;
+        }
+        data = (const char *) mapping + header.data_offset;
+
+        if(binary_array_checksum(data, bytes) != header.checksum) {
+            close();
+            return BINARY_ARRAY_BAD_CHECKSUM;
+        }
+
+        return BINARY_ARRAY_OK;
+    }
+
+    void close() {
+        if(mapping != NULL) munmap(mapping, size);
+        if(fd >= 0) ::close(fd);
+        mapping = NULL;
+        data = NULL;
+        fd = -1;
+    }
+};
+
+#endif
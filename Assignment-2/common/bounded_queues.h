@@ -0,0 +1,289 @@
+#ifndef BOUNDED_QUEUES_H
+#define BOUNDED_QUEUES_H
+
+#include<pthread.h>
+#include<semaphore.h>
+#include<sched.h>
+#include<cstdint>
+#include<atomic>
+#include<vector>
+#include<algorithm>
+#include "spinlock.h"
+
+//a spinning waiter gives up its cpu after this many rounds, so that it does not starve the thread it waits
+//for when there are more threads than cpus
+#define QUEUE_SPINS_BEFORE_YIELD 64
+
+//one chunk [low, high) of the array and when it was enqueued, high < 0 marks the end of a producer's stream
+struct queue_item {
+    long long low, high;
+    uint64_t enqueue_ns;
+};
+
+static inline void queue_spin_wait(int &spins) {
+    if(++spins < QUEUE_SPINS_BEFORE_YIELD) cpu_relax();
+    else sched_yield();
+}
+
+static inline size_t round_up_to_power_of_two(size_t value) {
+    size_t power = 1;
+    while(power < value) power *= 2;
+    return power;
+}
+
+//bounded queues behind one interface: reset(capacity, producers, consumers) while nobody uses the queue,
+//push(my_producer, item) blocks while it is full and pop(my_consumer) while it is empty
+//a queue with per_pair set has a channel for every (producer, consumer) pair, push_to picks the consumer
+
+//a ring guarded by two counting semaphores (free slots and items) and a mutex on each end
+struct semaphore_queue {
+    static const bool per_pair = false;
+
+    std::vector<queue_item> buffer;
+    size_t head = 0, tail = 0;
+    sem_t free_slots, items;
+    pthread_mutex_t producer_mutex, consumer_mutex;
+
+    semaphore_queue() {
+        sem_init(&free_slots, 0, 0);
+        sem_init(&items, 0, 0);
+        pthread_mutex_init(&producer_mutex, NULL);
+        pthread_mutex_init(&consumer_mutex, NULL);
+    }
+
+    ~semaphore_queue() {
+        sem_destroy(&free_slots);
+        sem_destroy(&items);
+        pthread_mutex_destroy(&producer_mutex);
+        pthread_mutex_destroy(&consumer_mutex);
+    }
+
+    void reset(int capacity, int, int) {
+        buffer.assign(capacity, queue_item());
+        head = tail = 0;
+        sem_destroy(&free_slots);
+        sem_destroy(&items);
+        sem_init(&free_slots, 0, capacity);
+        sem_init(&items, 0, 0);
+    }
+
+    void push(int, const queue_item &item) {
+        sem_wait(&free_slots);
+        pthread_mutex_lock(&producer_mutex);
+        buffer[tail] = item;
+        tail = (tail + 1) % buffer.size();
+        pthread_mutex_unlock(&producer_mutex);
+        sem_post(&items);
+    }
+
+    queue_item pop(int) {
+        sem_wait(&items);
+        pthread_mutex_lock(&consumer_mutex);
+        queue_item item = buffer[head];
+        head = (head + 1) % buffer.size();
+        pthread_mutex_unlock(&consumer_mutex);
+        sem_post(&free_slots);
+        return item;
+    }
+};
+
+//a ring guarded by one mutex, producers wait on not_full and consumers on not_empty
+struct condvar_queue {
+    static const bool per_pair = false;
+
+    std::vector<queue_item> buffer;
+    size_t head = 0, count = 0;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full, not_empty;
+
+    condvar_queue() {
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&not_full, NULL);
+        pthread_cond_init(&not_empty, NULL);
+    }
+
+    ~condvar_queue() {
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&not_full);
+        pthread_cond_destroy(&not_empty);
+    }
+
+    void reset(int capacity, int, int) {
+        buffer.assign(capacity, queue_item());
+        head = count = 0;
+    }
+
+    void push(int, const queue_item &item) {
+        pthread_mutex_lock(&mutex);
+        while(count == buffer.size())
+            pthread_cond_wait(&not_full, &mutex);
+        buffer[(head + count) % buffer.size()] = item;
+        count++;
+        pthread_cond_signal(&not_empty);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    queue_item pop(int) {
+        pthread_mutex_lock(&mutex);
+        while(count == 0)
+            pthread_cond_wait(&not_empty, &mutex);
+        queue_item item = buffer[head];
+        head = (head + 1) % buffer.size();
+        count--;
+        pthread_cond_signal(&not_full);
+        pthread_mutex_unlock(&mutex);
+        return item;
+    }
+};
+
+//Vyukov's bounded MPMC queue: every cell has a sequence number that tells whose turn it is, a producer (or
+//consumer) claims a position with a CAS on its end and then owns the cell without touching the other end
+struct vyukov_queue {
+    static const bool per_pair = false;
+
+    struct alignas(SPINLOCK_CACHE_LINE) cell {
+        std::atomic<size_t> sequence;
+        queue_item item;
+    };
+
+    std::vector<cell> cells;
+    size_t mask = 0;
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<size_t> enqueue_pos{0};
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<size_t> dequeue_pos{0};
+
+    //the capacity is rounded up to a power of two of at least 2: with a single cell "free for pos" and "holds
+    //the item of pos - 1" are the same sequence, so a second producer would overwrite an unconsumed item
+    void reset(int capacity, int, int) {
+        size_t size = round_up_to_power_of_two(std::max(capacity, 2));
+        cells = std::vector<cell>(size);
+        for(size_t i = 0; i < size; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        mask = size - 1;
+        enqueue_pos = dequeue_pos = 0;
+    }
+
+    void push(int, const queue_item &item) {
+        int spins = 0;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        cell *target;
+        while(true) {
+            target = &cells[pos & mask];
+            intptr_t difference = (intptr_t) target->sequence.load(std::memory_order_acquire) - (intptr_t) pos;
+            if(difference == 0) {
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else {
+                //full (the cell still holds the item of the previous round) or another producer got there first
+                if(difference < 0) queue_spin_wait(spins);
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        target->item = item;
+        target->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    queue_item pop(int) {
+        int spins = 0;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        cell *target;
+        while(true) {
+            target = &cells[pos & mask];
+            intptr_t difference = (intptr_t) target->sequence.load(std::memory_order_acquire) - (intptr_t) (pos + 1);
+            if(difference == 0) {
+                if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else {
+                if(difference < 0) queue_spin_wait(spins);
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        queue_item item = target->item;
+        target->sequence.store(pos + mask + 1, std::memory_order_release);
+        return item;
+    }
+};
+
+//single producer single consumer ring, each end keeps a copy of the other end's index and only reloads it
+//when the ring looks full (or empty), so in the steady state the two ends do not share a written line
+struct spsc_ring {
+    std::vector<queue_item> buffer;
+    size_t mask = 0;
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+
+    void reset(int capacity) {
+        buffer.assign(round_up_to_power_of_two(capacity), queue_item());
+        mask = buffer.size() - 1;
+        head = tail = 0;
+        cached_head = cached_tail = 0;
+    }
+
+    void push(const queue_item &item) {
+        size_t my_tail = tail.load(std::memory_order_relaxed);
+        int spins = 0;
+        while(my_tail - cached_head == buffer.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if(my_tail - cached_head == buffer.size()) queue_spin_wait(spins);
+        }
+        buffer[my_tail & mask] = item;
+        tail.store(my_tail + 1, std::memory_order_release);
+    }
+
+    bool try_pop(queue_item &item) {
+        size_t my_head = head.load(std::memory_order_relaxed);
+        if(my_head == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if(my_head == cached_tail) return false;
+        }
+        item = buffer[my_head & mask];
+        head.store(my_head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+//one SPSC ring of the full capacity per (producer, consumer) pair, a producer deals its items round robin
+//over the consumers and a consumer polls its rings round robin
+struct spsc_ring_set {
+    static const bool per_pair = true;
+
+    struct alignas(SPINLOCK_CACHE_LINE) cursor {
+        int next;
+    };
+
+    std::vector<spsc_ring> rings;
+    std::vector<cursor> next_consumer, next_producer;
+    int no_of_producers = 1, no_of_consumers = 1;
+
+    void reset(int capacity, int producers, int consumers) {
+        no_of_producers = producers;
+        no_of_consumers = consumers;
+        rings = std::vector<spsc_ring>(producers * consumers);
+        for(auto &ring : rings) ring.reset(capacity);
+        next_consumer.assign(producers, cursor{0});
+        next_producer.assign(consumers, cursor{0});
+    }
+
+    void push_to(int my_producer, int consumer, const queue_item &item) {
+        rings[my_producer * no_of_consumers + consumer].push(item);
+    }
+
+    void push(int my_producer, const queue_item &item) {
+        int &consumer = next_consumer[my_producer].next;
+        push_to(my_producer, consumer, item);
+        consumer = (consumer + 1) % no_of_consumers;
+    }
+
+    queue_item pop(int my_consumer) {
+        int &producer = next_producer[my_consumer].next;
+        int spins = 0, empty_rings = 0;
+        queue_item item;
+        while(!rings[producer * no_of_consumers + my_consumer].try_pop(item)) {
+            producer = (producer + 1) % no_of_producers;
+            if(++empty_rings % no_of_producers == 0) queue_spin_wait(spins);
+        }
+        producer = (producer + 1) % no_of_producers;
+        return item;
+    }
+};
+
+#endif
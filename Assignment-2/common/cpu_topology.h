@@ -0,0 +1,175 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include<sched.h>
+#include<unistd.h>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<algorithm>
+
+//a sweep may run up to this many threads per available cpu
+#define MAX_OVERSUBSCRIPTION 4
+
+enum affinity_policy {
+    AFFINITY_NONE,
+    AFFINITY_COMPACT,      //fill all hardware threads of a core, then the next core of the same package
+    AFFINITY_SCATTER,      //one thread per package in turn, the second hardware thread of a core comes last
+    AFFINITY_PHYSICAL      //only the first hardware thread of every core, round robin over the packages
+};
+
+[[maybe_unused]] static const char* affinity_policy_names[] = {"none", "compact", "scatter", "physical"};
+
+static inline long read_sys_value(const std::string &path, long fallback) {
+    FILE *file = fopen(path.c_str(), "r");
+    if(file == NULL) return fallback;
+    long value;
+    if(fscanf(file, "%ld", &value) != 1) value = fallback;
+    fclose(file);
+    return value;
+}
+
+//cpus the cgroup lets this process use on average (cpu.max for cgroup v2, cfs quota for v1), 0 if unlimited
+static inline int cgroup_cpu_limit() {
+    FILE *file = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if(file != NULL) {
+        char quota[32];
+        long period;
+        int fields = fscanf(file, "%31s %ld", quota, &period);
+        fclose(file);
+        if(fields == 2 && strcmp(quota, "max") != 0 && period > 0)
+            return std::max(1, (int) ceil((double) atol(quota) / period));
+        return 0;
+    }
+    long quota = read_sys_value("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", -1);
+    long period = read_sys_value("/sys/fs/cgroup/cpu/cpu.cfs_period_us", -1);
+    if(quota > 0 && period > 0) return std::max(1, (int) ceil((double) quota / period));
+    return 0;
+}
+
+//one hardware thread the process may run on, with the core and package it belongs to
+struct cpu_slot {
+    int cpu, core, package, smt_index;
+};
+
+struct cpu_topology {
+
+    std::vector<cpu_slot> slots;
+    int no_of_cores = 0, no_of_packages = 0;
+    int cgroup_limit = 0;
+
+    //reads the cpus of our affinity mask and their core/package ids from /sys, a cpu without topology
+    //information is taken to be a core of its own
+    void detect() {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if(sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+            for(int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < CPU_SETSIZE; cpu++)
+                CPU_SET(cpu, &mask);
+        }
+
+        slots.clear();
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if(!CPU_ISSET(cpu, &mask)) continue;
+            std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            cpu_slot slot;
+            slot.cpu = cpu;
+            slot.package = std::max(0L, read_sys_value(topology + "physical_package_id", 0));
+            slot.core = read_sys_value(topology + "core_id", cpu);
+            slots.push_back(slot);
+        }
+
+        //core ids are only unique within a package, number the (package, core) pairs and the hardware threads in them
+        std::sort(slots.begin(), slots.end(), [](const cpu_slot &a, const cpu_slot &b) {
+            if(a.package != b.package) return a.package < b.package;
+            if(a.core != b.core) return a.core < b.core;
+            return a.cpu < b.cpu;
+        });
+        no_of_cores = no_of_packages = 0;
+        for(size_t i = 0; i < slots.size(); i++) {
+            bool new_package = (i == 0 || slots[i].package != slots[i - 1].package);
+            bool new_core = new_package || slots[i].core != slots[i - 1].core;
+            no_of_packages += new_package;
+            no_of_cores += new_core;
+            slots[i].smt_index = new_core ? 0 : slots[i - 1].smt_index + 1;
+            slots[i].core = no_of_cores - 1;
+            slots[i].package = no_of_packages - 1;
+        }
+
+        cgroup_limit = cgroup_cpu_limit();
+    }
+
+    //the number of threads that can run at the same time
+    int available_cpus() const {
+        int cpus = std::max(1, (int) slots.size());
+        return (cgroup_limit > 0) ? std::min(cpus, cgroup_limit) : cpus;
+    }
+
+    //the cpu for each pool rank in order, empty for AFFINITY_NONE, ranks past the end wrap around
+    std::vector<int> cpu_order(affinity_policy policy) const {
+        std::vector<cpu_slot> order(slots);
+        if(policy == AFFINITY_NONE) order.clear();
+        if(policy == AFFINITY_PHYSICAL)
+            order.erase(std::remove_if(order.begin(), order.end(), [](const cpu_slot &slot) { return slot.smt_index != 0; }),
+                        order.end());
+        if(policy == AFFINITY_SCATTER || policy == AFFINITY_PHYSICAL) {
+            //the n-th core of each package is taken before the (n + 1)-th core of any package
+            std::vector<int> core_in_package(order.size());
+            for(size_t i = 0; i < order.size(); i++) {
+                bool same_package = (i > 0 && order[i].package == order[i - 1].package);
+                bool same_core = same_package && order[i].core == order[i - 1].core;
+                core_in_package[i] = !same_package ? 0 : core_in_package[i - 1] + !same_core;
+            }
+            std::vector<size_t> index(order.size());
+            for(size_t i = 0; i < index.size(); i++) index[i] = i;
+            std::stable_sort(index.begin(), index.end(), [&](size_t a, size_t b) {
+                if(order[a].smt_index != order[b].smt_index) return order[a].smt_index < order[b].smt_index;
+                if(core_in_package[a] != core_in_package[b]) return core_in_package[a] < core_in_package[b];
+                return order[a].package < order[b].package;
+            });
+            std::vector<cpu_slot> scattered;
+            for(size_t i : index) scattered.push_back(order[i]);
+            order = scattered;
+        }
+
+        std::vector<int> cpus;
+        for(auto &slot : order) cpus.push_back(slot.cpu);
+        return cpus;
+    }
+};
+
+//parses the thread counts of a sweep: "pow2" (1, 2, 4, ... up to the available cpus, which are included even if
+//they are no power of two), "all" (every count up to the available cpus) or a comma separated list
+//a count may be given as "Nx", N times the available cpus, and no count may exceed MAX_OVERSUBSCRIPTION times them
+static inline bool parse_thread_counts(const char *str, int available_cpus, std::vector<int> &counts) {
+    counts.clear();
+    if(strcmp(str, "pow2") == 0) {
+        for(int threads = 1; threads < available_cpus; threads *= 2)
+            counts.push_back(threads);
+        counts.push_back(available_cpus);
+        return true;
+    }
+    if(strcmp(str, "all") == 0) {
+        for(int threads = 1; threads <= available_cpus; threads++)
+            counts.push_back(threads);
+        return true;
+    }
+    while(*str != '\0') {
+        char *end;
+        long threads = strtol(str, &end, 10);
+        if(end != str && *end == 'x') {
+            threads *= available_cpus;
+            end++;
+        }
+        if(end == str || threads < 1 || threads > (long) MAX_OVERSUBSCRIPTION * available_cpus || (*end != ',' && *end != '\0'))
+            return false;
+        counts.push_back(threads);
+        str = (*end == ',') ? end + 1 : end;
+    }
+    return !counts.empty();
+}
+
+#endif
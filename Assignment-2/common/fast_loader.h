@@ -0,0 +1,242 @@
+#ifndef FAST_LOADER_H
+#define FAST_LOADER_H
+
+#include<pthread.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<cstdlib>
+#include<cstring>
+#include<cstdint>
+#include<algorithm>
+#include "bench_harness.h"
+
+//every chunk handed to a parser thread is at least this big, so small inputs are parsed serially
+#define LOADER_MIN_CHUNK (1 << 20)
+#define LOADER_MAX_THREADS 64
+
+//reads whitespace separated numbers from a memory mapped text file
+//the header values are read serially and the body is split at newline boundaries and parsed by
+//several threads, each of them first counting its tokens so that it knows where its values go
+struct fast_loader {
+
+    int fd = -1;
+    const char *data = NULL;
+    size_t size = 0;
+    size_t pos = 0;
+    double start_time = 0, load_time = 0;
+
+    static double wall_time() {
+        return monotonic_time();
+    }
+
+    static inline bool is_space(char c) {
+        return c == ' ' || (unsigned char) (c - '\t') <= ('\r' - '\t');
+    }
+
+    static inline bool is_digit(char c) {
+        return (unsigned char) (c - '0') < 10;
+    }
+
+    bool open(const char *file_name) {
+        start_time = wall_time();
+        fd = ::open(file_name, O_RDONLY);
+        if(fd < 0) return false;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size == 0) {
+            close();
+            return false;
+        }
+        size = st.st_size;
+        void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED) {
+            data = NULL;
+            close();
+            return false;
+        }
+        data = (const char *) mapping;
+        madvise(mapping, size, MADV_WILLNEED);
+        pos = 0;
+        return true;
+    }
+
+    void close() {
+        if(data != NULL) munmap((void *) data, size);
+        if(fd >= 0) ::close(fd);
+        data = NULL;
+        fd = -1;
+    }
+
+    //parses one integer token starting at p (which must not be whitespace), returns the position after it
+    static const char* parse_token(const char *p, const char *end, long long &value, bool &ok) {
+        bool negative = (p < end && *p == '-');
+        p += (p < end && (*p == '-' || *p == '+'));
+        const char *digits = p;
+        unsigned long long v = 0;
+        while(p < end && is_digit(*p))
+            v = v * 10 + (*p++ - '0');
+        ok = (p != digits) && (p == end || is_space(*p)) && (p - digits) <= 18;
+        value = negative ? -(long long) v : (long long) v;
+        return p;
+    }
+
+    static const char* parse_token(const char *p, const char *end, int &value, bool &ok) {
+        long long v;
+        p = parse_token(p, end, v, ok);
+        ok = ok && v >= INT32_MIN && v <= INT32_MAX;
+        value = (int) v;
+        return p;
+    }
+
+    //fixed point decimals (what the input generators write) are handled directly, anything longer or
+    //with an exponent falls back to strtod on a copy of the token
+    static const char* parse_token(const char *p, const char *end, double &value, bool &ok) {
+        static const double power_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                              1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+        const char *token = p;
+        bool negative = (p < end && *p == '-');
+        p += (p < end && (*p == '-' || *p == '+'));
+        unsigned long long mantissa = 0;
+        int no_of_digits = 0, no_of_fraction_digits = 0;
+        while(p < end && is_digit(*p)) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            no_of_digits++;
+        }
+        if(p < end && *p == '.') {
+            p++;
+            while(p < end && is_digit(*p)) {
+                mantissa = mantissa * 10 + (*p++ - '0');
+                no_of_digits++;
+                no_of_fraction_digits++;
+            }
+        }
+
+        if(no_of_digits > 0 && no_of_digits <= 15 && (p == end || is_space(*p))) {
+            value = (double) mantissa / power_of_ten[no_of_fraction_digits];
+            if(negative) value = -value;
+            ok = true;
+            return p;
+        }
+
+        while(p < end && !is_space(*p)) p++;
+        char buffer[64];
+        size_t length = p - token;
+        ok = (length > 0 && length < sizeof(buffer));
+        if(!ok) return p;
+        memcpy(buffer, token, length);
+        buffer[length] = '\0';
+        char *parse_end;
+        value = strtod(buffer, &parse_end);
+        ok = (parse_end == buffer + length);
+        return p;
+    }
+
+    //reads the next value serially, used for the header fields in front of the array
+    template<class T>
+    bool read(T &value) {
+        const char *p = data + pos, *end = data + size;
+        while(p < end && is_space(*p)) p++;
+        if(p == end) return false;
+        bool ok;
+        p = parse_token(p, end, value, ok);
+        pos = p - data;
+        load_time = wall_time() - start_time;
+        return ok;
+    }
+
+    template<class T>
+    struct chunk {
+        const char *begin, *end;
+        T *out;
+        long long first_index, count, no_of_tokens;
+        bool ok;
+    };
+
+    template<class T>
+    static void* count_chunk(void *arg) {
+        chunk<T> *c = (chunk<T> *) arg;
+        long long tokens = 0;
+        bool previous_space = true;
+        for(const char *p = c->begin; p < c->end; p++) {
+            bool space = is_space(*p);
+            tokens += previous_space & !space;
+            previous_space = space;
+        }
+        c->no_of_tokens = tokens;
+        return NULL;
+    }
+
+    template<class T>
+    static void* parse_chunk(void *arg) {
+        chunk<T> *c = (chunk<T> *) arg;
+        const char *p = c->begin;
+        long long last_index = std::min(c->first_index + c->no_of_tokens, c->count);
+        c->ok = true;
+        for(long long i = c->first_index; i < last_index; i++) {
+            while(is_space(*p)) p++;
+            bool ok;
+            p = parse_token(p, c->end, c->out[i], ok);
+            c->ok &= ok;
+        }
+        return NULL;
+    }
+
+    template<class T>
+    static void run_on_chunks(void* (*function) (void *), chunk<T> *chunks, int no_of_chunks) {
+        pthread_t threads[LOADER_MAX_THREADS];
+        bool created[LOADER_MAX_THREADS];
+        for(int chunk_no = 1; chunk_no < no_of_chunks; chunk_no++)
+            created[chunk_no] = (pthread_create(&threads[chunk_no], NULL, function, (void *) (&chunks[chunk_no])) == 0);
+        function((void *) (&chunks[0]));
+        for(int chunk_no = 1; chunk_no < no_of_chunks; chunk_no++) {
+            if(created[chunk_no]) pthread_join(threads[chunk_no], NULL);
+            else function((void *) (&chunks[chunk_no]));
+        }
+    }
+
+    //parses the next count values into out using all the available cores, returns false if the file
+    //holds fewer values than expected or any of them is malformed
+    template<class T>
+    bool read_array(T *out, long long count) {
+        const char *begin = data + pos, *end = data + size;
+        long long no_of_cores = sysconf(_SC_NPROCESSORS_ONLN);
+        int no_of_chunks = (int) std::max(1LL, std::min({no_of_cores, (long long) LOADER_MAX_THREADS,
+                                                          (long long) ((end - begin) / LOADER_MIN_CHUNK)}));
+
+        chunk<T> chunks[LOADER_MAX_THREADS];
+        const char *chunk_begin = begin;
+        for(int chunk_no = 0; chunk_no < no_of_chunks; chunk_no++) {
+            const char *chunk_end = (chunk_no == no_of_chunks - 1) ? end : begin + (end - begin) / no_of_chunks * (chunk_no + 1);
+            if(chunk_end < chunk_begin) chunk_end = chunk_begin;
+            chunk_end = (const char *) memchr(chunk_end, '\n', end - chunk_end);
+            chunk_end = (chunk_end == NULL) ? end : chunk_end + 1;
+            chunks[chunk_no] = {chunk_begin, chunk_end, out, 0, count, 0, true};
+            chunk_begin = chunk_end;
+        }
+
+        run_on_chunks(count_chunk<T>, chunks, no_of_chunks);
+        long long no_of_tokens = 0;
+        for(int chunk_no = 0; chunk_no < no_of_chunks; chunk_no++) {
+            chunks[chunk_no].first_index = no_of_tokens;
+            no_of_tokens += chunks[chunk_no].no_of_tokens;
+        }
+        if(no_of_tokens < count) return false;
+
+        run_on_chunks(parse_chunk<T>, chunks, no_of_chunks);
+        bool ok = true;
+        for(int chunk_no = 0; chunk_no < no_of_chunks; chunk_no++)
+            ok &= chunks[chunk_no].ok;
+
+        pos = size;
+        load_time = wall_time() - start_time;
+        return ok;
+    }
+
+    double throughput() {
+        return load_time > 0 ? size / load_time / (1 << 20) : 0;
+    }
+};
+
+#endif
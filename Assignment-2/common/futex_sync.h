@@ -0,0 +1,186 @@
+#ifndef FUTEX_SYNC_H
+#define FUTEX_SYNC_H
+
+#include<linux/futex.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<climits>
+#include<cstdlib>
+#include<cstring>
+#include<atomic>
+#include<algorithm>
+#include<memory>
+#include "spinlock.h"
+
+//spin-then-park primitives on raw futexes: a waiter first spins (re-reading the word) for a while, then
+//sleeps in the kernel, so a short wait costs no system call and a long one burns no cpu
+//the spin is a fixed number of rounds, or FUTEX_SPIN_ADAPTIVE: like glibc's adaptive mutexes every object
+//keeps a moving average of the rounds its waits took and spins up to twice that (at most FUTEX_MAX_SPIN)
+#define FUTEX_SPIN_ADAPTIVE (-1)
+#define FUTEX_MAX_SPIN 4000
+#define FUTEX_INITIAL_SPIN 100
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex words must be plain ints");
+
+static inline void futex_wait(std::atomic<int> *word, int expected) {
+    syscall(SYS_futex, (int *) word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(std::atomic<int> *word, int count) {
+    syscall(SYS_futex, (int *) word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+//parses the spin option: a number of rounds or "auto" for the adaptive spin
+static inline bool parse_spin_limit(const char *str, int &limit) {
+    if(strcmp(str, "auto") == 0) {
+        limit = FUTEX_SPIN_ADAPTIVE;
+        return true;
+    }
+    char *end;
+    long value = strtol(str, &end, 10);
+    if(end == str || *end != '\0' || value < 0 || value > INT_MAX) return false;
+    limit = value;
+    return true;
+}
+
+struct spin_policy {
+    int limit = FUTEX_SPIN_ADAPTIVE;
+    std::atomic<int> estimate{FUTEX_INITIAL_SPIN};
+
+    int rounds() const {
+        if(limit != FUTEX_SPIN_ADAPTIVE) return limit;
+        return std::min(FUTEX_MAX_SPIN, 2 * estimate.load(std::memory_order_relaxed) + 10);
+    }
+
+    //a wait that had to park counts as rounds() rounds, so the estimate grows while spinning does not pay
+    void update(int spun) {
+        if(limit != FUTEX_SPIN_ADAPTIVE) return;
+        int current = estimate.load(std::memory_order_relaxed);
+        estimate.store(current + (spun - current) / 8, std::memory_order_relaxed);
+    }
+};
+
+//Drepper's three state mutex (0 unlocked, 1 locked, 2 locked and maybe waiters) with a spin phase in front
+//of the sleep, unlock only makes the wake system call if somebody may be sleeping
+struct alignas(SPINLOCK_CACHE_LINE) futex_mutex {
+    std::atomic<int> state{0};
+    spin_policy spin;
+
+    void lock() {
+        int expected = 0;
+        if(state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) return;
+
+        int rounds = spin.rounds();
+        for(int round = 0; round < rounds; round++) {
+            cpu_relax();
+            expected = 0;
+            if(state.load(std::memory_order_relaxed) == 0
+               && state.compare_exchange_weak(expected, 1, std::memory_order_acquire)) {
+                spin.update(round);
+                return;
+            }
+        }
+        spin.update(rounds);
+
+        while(state.exchange(2, std::memory_order_acquire) != 0)
+            futex_wait(&state, 2);
+    }
+
+    void unlock() {
+        if(state.exchange(0, std::memory_order_release) == 2)
+            futex_wake(&state, 1);
+    }
+};
+
+//centralised barrier whose waiters spin on the generation and then sleep on it, the last thread to arrive
+//starts the next generation and only wakes the others if one of them went to sleep
+//reset(no_of_threads) and wait(my_rank) as for the barriers of barriers.h
+struct futex_barrier {
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<int> count{0};
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<int> generation{0};
+    std::atomic<int> sleepers{0};
+    int no_of_threads = 1;
+    spin_policy spin;
+
+    void reset(int threads) {
+        no_of_threads = threads;
+        count = 0;
+        sleepers = 0;
+    }
+
+    void wait(int) {
+        int my_generation = generation.load(std::memory_order_acquire);
+        if(count.fetch_add(1, std::memory_order_acq_rel) == no_of_threads - 1) {
+            count.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_seq_cst);
+            if(sleepers.load(std::memory_order_seq_cst) > 0) futex_wake(&generation, INT_MAX);
+            return;
+        }
+
+        int rounds = spin.rounds();
+        for(int round = 0; round < rounds; round++) {
+            if(generation.load(std::memory_order_acquire) != my_generation) {
+                spin.update(round);
+                return;
+            }
+            cpu_relax();
+        }
+        spin.update(rounds);
+
+        //announced before the generation is checked again, so the last thread either sees a sleeper or
+        //the sleeper sees the new generation
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while(generation.load(std::memory_order_seq_cst) == my_generation)
+            futex_wait(&generation, my_generation);
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+//point-to-point synchronisation through one cache-line padded step counter per rank: a rank publishes the
+//last step it completed and waits only for the ranks it exchanges data with, spinning on their counters and
+//then sleeping on them, publish only makes the wake system call if somebody sleeps on its counter
+struct neighbour_steps {
+    struct alignas(SPINLOCK_CACHE_LINE) padded_step {
+        std::atomic<int> step{0};
+        std::atomic<int> sleepers{0};
+    };
+
+    std::unique_ptr<padded_step[]> ranks;
+    spin_policy spin;
+
+    //every counter starts at step 0, while nobody waits
+    void reset(int no_of_threads) {
+        ranks.reset(new padded_step[no_of_threads]);
+    }
+
+    void publish(int my_rank, int step) {
+        padded_step &mine = ranks[my_rank];
+        mine.step.store(step, std::memory_order_seq_cst);
+        if(mine.sleepers.load(std::memory_order_seq_cst) > 0) futex_wake(&mine.step, INT_MAX);
+    }
+
+    //returns once rank has published step (or a later one)
+    void wait_for(int rank, int step) {
+        padded_step &other = ranks[rank];
+        if(other.step.load(std::memory_order_acquire) >= step) return;
+
+        int rounds = spin.rounds();
+        for(int round = 0; round < rounds; round++) {
+            cpu_relax();
+            if(other.step.load(std::memory_order_acquire) >= step) {
+                spin.update(round);
+                return;
+            }
+        }
+        spin.update(rounds);
+
+        //announced before the counter is read again, as for the barrier's sleepers
+        other.sleepers.fetch_add(1, std::memory_order_seq_cst);
+        int seen;
+        while((seen = other.step.load(std::memory_order_seq_cst)) < step)
+            futex_wait(&other.step, seen);
+        other.sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+#endif
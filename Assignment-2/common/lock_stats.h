@@ -0,0 +1,151 @@
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+//wait and hold time instrumentation of the synchronisation calls, compiled in with -DLOCK_STATS (make STATS=1),
+//otherwise every macro expands to the bare call and nothing is recorded
+//  LOCK_STATS_ACQUIRE(rank, call)   a lock acquisition, the wait is timed and the hold starts when it returns
+//  LOCK_STATS_RELEASE(rank, call)   the matching release, ends the hold
+//  LOCK_STATS_WAIT(rank, call)      a wait that is not followed by a release (barrier, condition variable), a
+//                                   condition variable returns with the mutex held again, so the hold restarts
+//  LOCK_STATS_SECTION(label)        names the experiment the following runs belong to
+//  LOCK_STATS_BEGIN_RUN(threads)    clears the per thread statistics before a run
+//  LOCK_STATS_END_RUN(strategy, threads, warmup)
+//                                   appends one line per thread to LOCK_STATS_FILE and adds measured runs to the summary
+//  LOCK_STATS_PRINT_SUMMARY()       prints the summary of every (section, strategy, threads) to cout
+
+#ifdef LOCK_STATS
+
+#include<cstdio>
+#include<cstdint>
+#include<string>
+#include<vector>
+#include<map>
+#include<tuple>
+#include<iostream>
+#include<iomanip>
+#include "log_histogram.h"
+#include "bench_harness.h"
+
+#define LOCK_STATS_FILE "lock_stats.csv"
+//an acquisition that waited longer than this counts as contended, an uncontended lock takes a few dozen cycles
+#define LOCK_STATS_CONTENDED_CYCLES 1000
+
+static inline uint64_t lock_stats_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+struct alignas(64) lock_thread_stats {
+    log_histogram wait, hold;
+    uint64_t contended = 0, hold_start = 0;
+};
+
+struct lock_stats_summary {
+    log_histogram wait, hold;
+    uint64_t contended = 0;
+    int runs = 0;
+};
+
+struct lock_stats {
+    static inline std::vector<lock_thread_stats> threads;
+    static inline std::string section;
+    static inline std::map<std::tuple<std::string, std::string, int>, lock_stats_summary> summaries;
+    static inline std::vector<std::tuple<std::string, std::string, int>> order;
+    static inline FILE *file = NULL;
+    static inline int run_no = 0;
+
+    static void begin_run(int no_of_threads) {
+        threads.assign(no_of_threads, lock_thread_stats());
+    }
+
+    static void acquired(int rank, uint64_t start) {
+        uint64_t now = lock_stats_cycles();
+        threads[rank].wait.record(now - start);
+        threads[rank].contended += (now - start > LOCK_STATS_CONTENDED_CYCLES);
+        threads[rank].hold_start = now;
+    }
+
+    static void released(int rank) {
+        threads[rank].hold.record(lock_stats_cycles() - threads[rank].hold_start);
+    }
+
+    static void end_run(const std::string &strategy, int no_of_threads, bool warmup) {
+        if(file == NULL) {
+            file = fopen(LOCK_STATS_FILE, "w");
+            if(file == NULL) return;
+            fprintf(file, "section,strategy,threads,run,warmup,rank,waits,contended,wait_mean,wait_p50,wait_p99,wait_max,"
+                          "holds,hold_mean,hold_p50,hold_p99,hold_max\n");
+        }
+        auto key = std::make_tuple(section, strategy, no_of_threads);
+        if(!warmup && summaries.find(key) == summaries.end()) order.push_back(key);
+        lock_stats_summary *summary = warmup ? NULL : &summaries[key];
+        for(int rank = 0; rank < no_of_threads; rank++) {
+            lock_thread_stats &stats = threads[rank];
+            fprintf(file, "\"%s\",%s,%d,%d,%d,%d,%llu,%llu,%.1f,%.0f,%.0f,%llu,%llu,%.1f,%.0f,%.0f,%llu\n", section.c_str(),
+                    strategy.c_str(), no_of_threads, run_no, warmup, rank, (unsigned long long) stats.wait.total,
+                    (unsigned long long) stats.contended, stats.wait.mean(), stats.wait.percentile(50), stats.wait.percentile(99),
+                    (unsigned long long) stats.wait.max, (unsigned long long) stats.hold.total, stats.hold.mean(),
+                    stats.hold.percentile(50), stats.hold.percentile(99), (unsigned long long) stats.hold.max);
+            if(summary != NULL) {
+                summary->wait.merge(stats.wait);
+                summary->hold.merge(stats.hold);
+                summary->contended += stats.contended;
+            }
+        }
+        if(summary != NULL) summary->runs++;
+        run_no++;
+    }
+
+    static void print_summary() {
+        std::cout << "Lock statistics in cycles over the measured runs (every run of every thread is in " << LOCK_STATS_FILE << "):\n";
+        std::string last_section;
+        for(auto &key : order) {
+            lock_stats_summary &summary = summaries[key];
+            //the lock-free strategies never wait
+            if(summary.wait.total == 0) continue;
+            if(std::get<0>(key) != last_section) {
+                last_section = std::get<0>(key);
+                std::cout << last_section << "\n" << std::setw(26) << std::left << "strategy" << std::right << std::setw(8) << "threads"
+                          << std::setw(12) << "waits/run" << std::setw(11) << "contended" << std::setw(12) << "wait p50"
+                          << std::setw(12) << "wait p99" << std::setw(14) << "wait max" << std::setw(12) << "hold p50"
+                          << std::setw(12) << "hold p99" << std::setw(14) << "hold max" << "\n";
+            }
+            double waits = summary.wait.total;
+            std::cout << std::setw(26) << std::left << std::get<1>(key) << std::right << std::setw(8) << std::get<2>(key)
+                      << std::fixed << std::setprecision(0) << std::setw(12) << waits / std::max(1, summary.runs)
+                      << std::setw(10) << std::setprecision(1) << (waits > 0 ? 100 * summary.contended / waits : 0) << "%"
+                      << std::setprecision(0) << std::setw(12) << summary.wait.percentile(50) << std::setw(12) << summary.wait.percentile(99)
+                      << std::setw(14) << (double) summary.wait.max << std::setw(12) << summary.hold.percentile(50)
+                      << std::setw(12) << summary.hold.percentile(99) << std::setw(14) << (double) summary.hold.max << "\n";
+        }
+        std::cout << "\n";
+        if(file != NULL) fclose(file);
+        file = NULL;
+    }
+};
+
+#define LOCK_STATS_ACQUIRE(rank, ...) do { uint64_t lock_stats_start = lock_stats_cycles(); __VA_ARGS__; \
+                                           lock_stats::acquired(rank, lock_stats_start); } while(0)
+#define LOCK_STATS_RELEASE(rank, ...) do { lock_stats::released(rank); __VA_ARGS__; } while(0)
+#define LOCK_STATS_WAIT(rank, ...) LOCK_STATS_ACQUIRE(rank, __VA_ARGS__)
+#define LOCK_STATS_SECTION(label) (lock_stats::section = (label))
+#define LOCK_STATS_BEGIN_RUN(no_of_threads) lock_stats::begin_run(no_of_threads)
+#define LOCK_STATS_END_RUN(strategy, no_of_threads, warmup) lock_stats::end_run(strategy, no_of_threads, warmup)
+#define LOCK_STATS_PRINT_SUMMARY() lock_stats::print_summary()
+
+#else
+
+#define LOCK_STATS_ACQUIRE(rank, ...) __VA_ARGS__
+#define LOCK_STATS_RELEASE(rank, ...) __VA_ARGS__
+#define LOCK_STATS_WAIT(rank, ...) __VA_ARGS__
+#define LOCK_STATS_SECTION(label) ((void) 0)
+#define LOCK_STATS_BEGIN_RUN(no_of_threads) ((void) 0)
+#define LOCK_STATS_END_RUN(strategy, no_of_threads, warmup) ((void) 0)
+#define LOCK_STATS_PRINT_SUMMARY() ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef LOG_HISTOGRAM_H
+#define LOG_HISTOGRAM_H
+
+#include<cstdint>
+#include<cstring>
+#include<algorithm>
+
+//values below this are counted exactly, above it every power of two is split into LOG_HISTOGRAM_SUB_BUCKETS
+#define LOG_HISTOGRAM_LINEAR 16
+#define LOG_HISTOGRAM_SUB_BITS 3
+#define LOG_HISTOGRAM_SUB_BUCKETS (1 << LOG_HISTOGRAM_SUB_BITS)
+#define LOG_HISTOGRAM_BUCKETS (LOG_HISTOGRAM_LINEAR + (64 - 4) * LOG_HISTOGRAM_SUB_BUCKETS)
+
+//histogram of non negative 64 bit values (nanoseconds, cycles) with a relative error below 1/8, fixed
+//size so that recording never allocates, one per thread merged after the run
+struct log_histogram {
+
+    uint64_t counts[LOG_HISTOGRAM_BUCKETS];
+    uint64_t total, max;
+    //the sum is kept for the mean, in double so that it cannot overflow
+    double sum;
+
+    log_histogram() {
+        clear();
+    }
+
+    void clear() {
+        memset(counts, 0, sizeof(counts));
+        total = max = 0;
+        sum = 0;
+    }
+
+    static int bucket(uint64_t value) {
+        if(value < LOG_HISTOGRAM_LINEAR) return value;
+        int exponent = 63 - __builtin_clzll(value);
+        int sub = (value >> (exponent - LOG_HISTOGRAM_SUB_BITS)) & (LOG_HISTOGRAM_SUB_BUCKETS - 1);
+        return LOG_HISTOGRAM_LINEAR + (exponent - 4) * LOG_HISTOGRAM_SUB_BUCKETS + sub;
+    }
+
+    //the smallest value that falls into bucket index
+    static uint64_t bucket_low(int index) {
+        if(index < LOG_HISTOGRAM_LINEAR) return index;
+        int exponent = (index - LOG_HISTOGRAM_LINEAR) / LOG_HISTOGRAM_SUB_BUCKETS + 4;
+        int sub = (index - LOG_HISTOGRAM_LINEAR) % LOG_HISTOGRAM_SUB_BUCKETS;
+        return (1ULL << exponent) + ((uint64_t) sub << (exponent - LOG_HISTOGRAM_SUB_BITS));
+    }
+
+    void record(uint64_t value) {
+        counts[bucket(value)]++;
+        total++;
+        sum += value;
+        max = std::max(max, value);
+    }
+
+    void merge(const log_histogram &other) {
+        for(int index = 0; index < LOG_HISTOGRAM_BUCKETS; index++)
+            counts[index] += other.counts[index];
+        total += other.total;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    double mean() const {
+        return (total == 0) ? 0 : sum / total;
+    }
+
+    //percentile (0 to 100), the middle of the bucket it falls into (but never above the maximum)
+    double percentile(double pct) const {
+        if(total == 0) return 0;
+        uint64_t rank = std::min(total, (uint64_t) (pct / 100 * total) + 1);
+        uint64_t seen = 0;
+        for(int index = 0; index < LOG_HISTOGRAM_BUCKETS; index++) {
+            seen += counts[index];
+            if(seen >= rank) {
+                //a linear bucket holds exactly its index, the last one is open ended, so its best value is the maximum
+                if(index < LOG_HISTOGRAM_LINEAR) return std::min((uint64_t) index, max);
+                if(index + 1 == LOG_HISTOGRAM_BUCKETS) return max;
+                double low = bucket_low(index), high = bucket_low(index + 1);
+                return std::min((low + high) / 2, (double) max);
+            }
+        }
+        return max;
+    }
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef NUMA_ALLOC_H
+#define NUMA_ALLOC_H
+
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<dirent.h>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<cstdint>
+#include<vector>
+#include<algorithm>
+
+//the memory policy calls are made through syscall() so that libnuma is not needed, the constants are
+//the ones of <linux/mempolicy.h>
+#define NUMA_MPOL_INTERLEAVE 3
+#define NUMA_MAX_NODES 1024
+#define NUMA_MAX_SAMPLED_PAGES 65536
+#define HUGE_PAGE_SIZE (2 << 20)
+
+enum numa_placement {
+    PLACEMENT_DEFAULT,         //the pages land wherever the thread that fills the array runs
+    PLACEMENT_INTERLEAVE,      //round robin over all nodes, page by page
+    PLACEMENT_FIRST_TOUCH      //every worker fills (and so places) its own slice
+};
+
+enum page_kind {
+    PAGES_DEFAULT,
+    PAGES_TRANSPARENT,         //madvise(MADV_HUGEPAGE) on a 2 MB aligned mapping
+    PAGES_EXPLICIT             //MAP_HUGETLB from the reserved pool (vm.nr_hugepages)
+};
+
+[[maybe_unused]] static const char* numa_placement_names[] = {"default", "interleave", "first-touch"};
+[[maybe_unused]] static const char* page_kind_names[] = {"default", "thp", "huge"};
+
+//the nodes listed in /sys, a machine without NUMA support counts as one node
+static inline int numa_no_of_nodes() {
+    DIR *dir = opendir("/sys/devices/system/node");
+    if(dir == NULL) return 1;
+    int highest = 0;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL) {
+        int node;
+        if(sscanf(entry->d_name, "node%d", &node) == 1) highest = std::max(highest, node);
+    }
+    closedir(dir);
+    return std::min(highest + 1, NUMA_MAX_NODES);
+}
+
+//the number of pages on each node among up to NUMA_MAX_SAMPLED_PAGES evenly spread pages of [data, data + bytes),
+//found with move_pages without target nodes, the last entry counts the pages whose node could not be determined
+//(not yet touched, or no NUMA support in the kernel)
+static inline std::vector<long> numa_page_placement(const void *data, size_t bytes) {
+    std::vector<long> counts(numa_no_of_nodes() + 1, 0);
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t first_page = (uintptr_t) data / page_size * page_size;
+    size_t no_of_pages = ((uintptr_t) data + bytes - first_page + page_size - 1) / page_size;
+    size_t stride = std::max((size_t) 1, no_of_pages / NUMA_MAX_SAMPLED_PAGES);
+
+    std::vector<void *> sampled;
+    for(size_t page_no = 0; page_no < no_of_pages; page_no += stride)
+        sampled.push_back((void *) (first_page + page_no * page_size));
+    std::vector<int> status(sampled.size(), -1);
+    if(!sampled.empty() && syscall(SYS_move_pages, 0, sampled.size(), sampled.data(), NULL, status.data(), 0) != 0)
+        std::fill(status.begin(), status.end(), -1);
+
+    for(int node : status) {
+        if(node >= 0 && node < (int) counts.size() - 1) counts[node]++;
+        else counts.back()++;
+    }
+    return counts;
+}
+
+//an anonymous mapping whose pages are placed by policy and possibly backed by huge pages
+struct placed_buffer {
+
+    void *data = NULL;
+    size_t mapped_bytes = 0;
+    numa_placement placement = PLACEMENT_DEFAULT;
+    page_kind pages = PAGES_DEFAULT;
+    //explicit huge pages fall back to transparent ones if the pool is empty, this is what was used
+    page_kind used_pages = PAGES_DEFAULT;
+
+    //maps at least bytes, nothing is touched yet so the placement of every page is decided by the policy
+    //set here or by the thread that writes it first
+    bool allocate(size_t bytes, numa_placement placement_policy, page_kind page_policy) {
+        placement = placement_policy;
+        pages = used_pages = page_policy;
+        size_t page_size = (pages == PAGES_DEFAULT) ? sysconf(_SC_PAGESIZE) : HUGE_PAGE_SIZE;
+        mapped_bytes = (bytes + page_size - 1) / page_size * page_size;
+
+        data = MAP_FAILED;
+        if(pages == PAGES_EXPLICIT) {
+            data = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(data == MAP_FAILED) used_pages = PAGES_TRANSPARENT;
+        }
+        if(data == MAP_FAILED) {
+            //a huge page more is mapped so that the start can be aligned to one, the rest is unmapped again
+            size_t extra = (used_pages == PAGES_DEFAULT) ? 0 : HUGE_PAGE_SIZE;
+            char *mapping = (char *) mmap(NULL, mapped_bytes + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(mapping == MAP_FAILED) {
+                data = NULL;
+                return false;
+            }
+            char *aligned = (extra == 0) ? mapping : (char *) (((uintptr_t) mapping + extra - 1) / extra * extra);
+            if(aligned > mapping) munmap(mapping, aligned - mapping);
+            if(mapping + extra > aligned) munmap(aligned + mapped_bytes, mapping + extra - aligned);
+            data = aligned;
+        }
+        if(used_pages == PAGES_TRANSPARENT) madvise(data, mapped_bytes, MADV_HUGEPAGE);
+
+        if(placement == PLACEMENT_INTERLEAVE) {
+            int nodes = numa_no_of_nodes();
+            std::vector<unsigned long> mask((nodes + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long)), 0);
+            for(int node = 0; node < nodes; node++)
+                mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+            //fails without NUMA support in the kernel, the pages are then placed as by default
+            syscall(SYS_mbind, data, mapped_bytes, NUMA_MPOL_INTERLEAVE, mask.data(), nodes + 1, 0);
+        }
+        return true;
+    }
+
+    void release() {
+        if(data != NULL) munmap(data, mapped_bytes);
+        data = NULL;
+        mapped_bytes = 0;
+    }
+};
+
+#endif
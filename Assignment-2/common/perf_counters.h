@@ -0,0 +1,163 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include<linux/perf_event.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<cstring>
+#include<cstdint>
+
+//the counters captured for every run, in two groups: the hardware events share one group (so they are
+//scheduled onto the PMU together) and the software events another
+#define PERF_NO_OF_EVENTS 6
+#define PERF_NO_OF_HW_EVENTS 4
+
+static const char* perf_event_names[PERF_NO_OF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses",
+                                                          "context_switches", "cpu_migrations"};
+static const uint32_t perf_event_types[PERF_NO_OF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                             PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+static const uint64_t perf_event_configs[PERF_NO_OF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                               PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                                                               PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_CPU_MIGRATIONS};
+
+struct perf_counts {
+    double value[PERF_NO_OF_EVENTS];
+};
+
+static inline void perf_clear(perf_counts &counts) {
+    for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++)
+        counts.value[event_no] = 0;
+}
+
+//adds run / no_of_runs to average, an event missing from any run stays at -1
+static inline void perf_accumulate(perf_counts &average, const perf_counts &run, int no_of_runs) {
+    for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++) {
+        if(average.value[event_no] < 0 || run.value[event_no] < 0) average.value[event_no] = -1;
+        else average.value[event_no] += run.value[event_no] / no_of_runs;
+    }
+}
+
+static inline void perf_scale(perf_counts &counts, double factor) {
+    for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++)
+        if(counts.value[event_no] > 0) counts.value[event_no] *= factor;
+}
+
+//counter groups attached to one thread (given by its tid), events which cannot be opened on this
+//machine (e.g. no PMU inside a VM) are left out and read back as -1
+struct perf_thread_counters {
+
+    int fd[PERF_NO_OF_EVENTS];
+
+    static int open_event(int event_no, pid_t tid, int group_fd) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_event_types[event_no];
+        attr.config = perf_event_configs[event_no];
+        attr.disabled = (group_fd == -1);
+        //context switches and migrations happen inside the kernel, so only the hardware events exclude it
+        attr.exclude_kernel = (perf_event_types[event_no] == PERF_TYPE_HARDWARE);
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return syscall(SYS_perf_event_open, &attr, tid, -1, group_fd, 0);
+    }
+
+    void open_group(int first, int last, pid_t tid) {
+        fd[first] = open_event(first, tid, -1);
+        for(int event_no = first + 1; event_no < last; event_no++)
+            fd[event_no] = (fd[first] >= 0) ? open_event(event_no, tid, fd[first]) : -1;
+    }
+
+    //returns false if not even the software counters could be opened (perf_event_paranoid, seccomp)
+    bool open(pid_t tid) {
+        open_group(0, PERF_NO_OF_HW_EVENTS, tid);
+        open_group(PERF_NO_OF_HW_EVENTS, PERF_NO_OF_EVENTS, tid);
+        return fd[0] >= 0 || fd[PERF_NO_OF_HW_EVENTS] >= 0;
+    }
+
+    void close() {
+        for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++) {
+            if(fd[event_no] >= 0) ::close(fd[event_no]);
+            fd[event_no] = -1;
+        }
+    }
+
+    void control(unsigned long request) {
+        for(int leader : {0, PERF_NO_OF_HW_EVENTS})
+            if(fd[leader] >= 0) ioctl(fd[leader], request, PERF_IOC_FLAG_GROUP);
+    }
+
+    //adds the counts of both groups to counts, scaled up if the kernel had to multiplex the group
+    void read_into(perf_counts &counts) {
+        for(int leader : {0, PERF_NO_OF_HW_EVENTS}) {
+            int last = (leader == 0) ? PERF_NO_OF_HW_EVENTS : PERF_NO_OF_EVENTS;
+            if(fd[leader] < 0) {
+                for(int event_no = leader; event_no < last; event_no++) counts.value[event_no] = -1;
+                continue;
+            }
+
+            uint64_t buffer[3 + PERF_NO_OF_EVENTS];
+            if(::read(fd[leader], buffer, sizeof(buffer)) <= 0) continue;
+            uint64_t no_of_values = buffer[0], time_enabled = buffer[1], time_running = buffer[2];
+            double scale = (time_running > 0) ? (double) time_enabled / time_running : 1;
+            int value_no = 0;
+            for(int event_no = leader; event_no < last; event_no++) {
+                if(fd[event_no] < 0) {
+                    counts.value[event_no] = -1;
+                } else if(counts.value[event_no] >= 0 && value_no < (int) no_of_values) {
+                    counts.value[event_no] += buffer[3 + value_no++] * scale;
+                }
+            }
+        }
+    }
+};
+
+//counters for every worker of a thread pool, enabled around each run and summed over the workers
+//that took part in it
+struct perf_session {
+
+    int no_of_threads = 0;
+    perf_thread_counters *counters = NULL;
+
+    bool open(const pid_t *tids, int threads) {
+        counters = new perf_thread_counters[threads];
+        no_of_threads = threads;
+        bool ok = true;
+        for(int thread_no = 0; thread_no < threads; thread_no++)
+            ok &= counters[thread_no].open(tids[thread_no]);
+        if(!ok) close();
+        return ok;
+    }
+
+    void close() {
+        for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
+            counters[thread_no].close();
+        delete[] counters;
+        counters = NULL;
+        no_of_threads = 0;
+    }
+
+    bool is_open() {
+        return counters != NULL;
+    }
+
+    void start(int threads) {
+        for(int thread_no = 0; thread_no < threads; thread_no++) {
+            counters[thread_no].control(PERF_EVENT_IOC_RESET);
+            counters[thread_no].control(PERF_EVENT_IOC_ENABLE);
+        }
+    }
+
+    perf_counts stop(int threads) {
+        perf_counts counts;
+        perf_clear(counts);
+        for(int thread_no = 0; thread_no < threads; thread_no++) {
+            counters[thread_no].control(PERF_EVENT_IOC_DISABLE);
+            counters[thread_no].read_into(counts);
+        }
+        return counts;
+    }
+};
+
+#endif
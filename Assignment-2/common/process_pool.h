@@ -0,0 +1,163 @@
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include<pthread.h>
+#include<sched.h>
+#include<semaphore.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/wait.h>
+#include<cstdio>
+#include<cfloat>
+#include<algorithm>
+#include "thread_pool.h"
+#include "bench_harness.h"
+
+//a MAP_SHARED mapping of a new shm_open object, which is unlinked right away so that nothing is left in /dev/shm
+//even if the program dies, forked children inherit the mapping, returns NULL on failure
+static inline void* shared_alloc(size_t bytes) {
+    static int segment_no = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "/parallel_sum.%d.%d", (int) getpid(), segment_no++);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0) return NULL;
+    shm_unlink(name);
+    void *memory = (ftruncate(fd, bytes) == 0) ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    return (memory == MAP_FAILED) ? NULL : memory;
+}
+
+static inline void shared_free(void *memory, size_t bytes) {
+    if(memory != NULL) munmap(memory, bytes);
+}
+
+//the thread_pool with forked worker processes: the start and done semaphores, the job and its timings live in
+//a shared segment, a worker sees the parent's memory as it was at the fork (copy on write), so everything a
+//job reads that changes later has to be passed through shared memory as well
+//fork from a parent whose other threads are idle, a child must not depend on locks held by the others at the fork
+struct process_pool {
+
+    struct alignas(64) worker_slot {
+        sem_t start_sem;
+        double job_begin, job_end, cpu_time;
+    };
+
+    struct control_block {
+        sem_t done_sem;
+        volatile bool stop_flag;
+        pool_job_p job;
+    };
+
+    int no_of_workers = 0;
+    pid_t *pid = NULL;
+    control_block *control = NULL;
+    worker_slot *slots = NULL;
+    size_t shared_bytes = 0;
+
+    //wall time taken to fork all the workers and have each of them reach its wait loop
+    double startup_time = 0;
+    //cpu seconds of the workers in the last run, summed over them
+    double cpu_time = 0;
+
+    static void worker(process_pool *pool, int my_rank) {
+        worker_slot &slot = pool->slots[my_rank];
+
+        sem_post(&pool->control->done_sem);
+        while(true) {
+            while(sem_wait(&slot.start_sem));
+            if(pool->control->stop_flag) break;
+            double cpu_start = process_cpu_time();
+            slot.job_begin = monotonic_time();
+            pool->control->job((void *) (&my_rank));
+            slot.job_end = monotonic_time();
+            slot.cpu_time = process_cpu_time() - cpu_start;
+            sem_post(&pool->control->done_sem);
+        }
+
+        _exit(0);
+    }
+
+    //forks the workers, returns false (after cleaning up) if the segment or any of them could not be created
+    bool start(int workers) {
+        no_of_workers = 0;
+        shared_bytes = (sizeof(control_block) + 63) / 64 * 64 + workers * sizeof(worker_slot);
+        control = (control_block *) shared_alloc(shared_bytes);
+        if(control == NULL) return false;
+        slots = (worker_slot *) ((char *) control + (sizeof(control_block) + 63) / 64 * 64);
+        pid = new pid_t[workers];
+        control->stop_flag = false;
+        sem_init(&control->done_sem, 1, 0);
+
+        double start_time = monotonic_time();
+        for(int process_no = 0; process_no < workers; process_no++) {
+            sem_init(&slots[process_no].start_sem, 1, 0);
+            pid[process_no] = fork();
+            if(pid[process_no] == 0) worker(this, process_no);
+            if(pid[process_no] < 0) {
+                sem_destroy(&slots[process_no].start_sem);
+                stop();
+                return false;
+            }
+            no_of_workers++;
+        }
+        for(int process_no = 0; process_no < no_of_workers; process_no++)
+            while(sem_wait(&control->done_sem));
+        startup_time = monotonic_time() - start_time;
+
+        return true;
+    }
+
+    //pins worker rank i to cpus[i % no_of_cpus], returns false if any of them could not be pinned
+    bool pin(const int *cpus, int no_of_cpus) {
+        bool ok = true;
+        for(int process_no = 0; process_no < no_of_workers && no_of_cpus > 0; process_no++) {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            CPU_SET(cpus[process_no % no_of_cpus], &mask);
+            ok &= (sched_setaffinity(pid[process_no], sizeof(mask), &mask) == 0);
+        }
+        return ok;
+    }
+
+    //runs the job on the first no_of_processes workers and returns the time between the first
+    //worker starting the job and the last worker finishing it
+    double run(pool_job_p function, int no_of_processes) {
+        control->job = function;
+        for(int process_no = 0; process_no < no_of_processes; process_no++)
+            sem_post(&slots[process_no].start_sem);
+        for(int process_no = 0; process_no < no_of_processes; process_no++)
+            while(sem_wait(&control->done_sem));
+
+        double first_begin = DBL_MAX, last_end = -DBL_MAX;
+        cpu_time = 0;
+        for(int process_no = 0; process_no < no_of_processes; process_no++) {
+            first_begin = std::min(first_begin, slots[process_no].job_begin);
+            last_end = std::max(last_end, slots[process_no].job_end);
+            cpu_time += slots[process_no].cpu_time;
+        }
+
+        return last_end - first_begin;
+    }
+
+    void stop() {
+        if(control == NULL) return;
+        control->stop_flag = true;
+        for(int process_no = 0; process_no < no_of_workers; process_no++)
+            sem_post(&slots[process_no].start_sem);
+        for(int process_no = 0; process_no < no_of_workers; process_no++) {
+            waitpid(pid[process_no], NULL, 0);
+            sem_destroy(&slots[process_no].start_sem);
+        }
+        sem_destroy(&control->done_sem);
+
+        shared_free(control, shared_bytes);
+        delete[] pid;
+        no_of_workers = 0;
+        control = NULL;
+        slots = NULL;
+        pid = NULL;
+    }
+};
+
+#endif
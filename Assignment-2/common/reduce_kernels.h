@@ -0,0 +1,280 @@
+#ifndef REDUCE_KERNELS_H
+#define REDUCE_KERNELS_H
+
+#include<immintrin.h>
+#include<cstdint>
+#include<cstring>
+#include<cmath>
+#include<type_traits>
+#include "binary_array.h"
+
+//sums elements [low, high) of an array of any element type, the integer kernels add into 64 bit lanes and the
+//floating point ones are Kahan compensated (in the element precision per lane, in double across the lanes),
+//their result is rounded to the nearest integer so that every kernel can be plugged into the same strategies
+typedef long long (*reduce_kernel_p) (const void *data, long long low, long long high);
+
+enum simd_isa {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512,
+    NO_OF_ISAS
+};
+
+[[maybe_unused]] static const char* simd_isa_names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+//the widest instruction set this cpu runs
+static inline simd_isa detect_simd_isa() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) return ISA_AVX512;
+    if(__builtin_cpu_supports("avx2")) return ISA_AVX2;
+    if(__builtin_cpu_supports("sse2")) return ISA_SSE2;
+    return ISA_SCALAR;
+}
+
+//compensated running sum: the low order bits lost by sum + value are kept in compensation and fed back
+struct kahan_sum {
+    double sum = 0, compensation = 0;
+
+    inline void add(double value) {
+        double y = value - compensation;
+        double t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+};
+
+template<class T>
+static inline long long reduce_scalar_tail(const T *values, long long low, long long high, long long partial,
+                                           kahan_sum &kahan) {
+    if(std::is_floating_point<T>::value) {
+        for(long long i = low; i < high; i++) kahan.add(values[i]);
+        return llround(kahan.sum);
+    }
+    //in unsigned arithmetic so that a sum of int64 elements wraps around instead of overflowing
+    unsigned long long sum = partial;
+    for(long long i = low; i < high; i++) sum += (long long) values[i];
+    return sum;
+}
+
+template<class T>
+long long reduce_scalar(const void *data, long long low, long long high) {
+    kahan_sum kahan;
+    return reduce_scalar_tail((const T *) data, low, high, 0, kahan);
+}
+
+template<class T>
+static inline T load_unaligned(const void *p) {
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+
+//SSE2 (every x86-64 cpu): 2 lanes of 64 bit integers, 4 floats or 2 doubles
+//there is no sign extension instruction before SSE4.1, the sign is unpacked in from a compare/shift
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static inline __m128i sse2_widen_32_to_64(__m128i x) {
+    return _mm_unpacklo_epi32(x, _mm_srai_epi32(x, 31));
+}
+
+SSE2 static inline __m128i sse2_widen2(const int8_t *p) {
+    __m128i x = _mm_cvtsi32_si128(load_unaligned<int16_t>(p));
+    x = _mm_unpacklo_epi8(x, _mm_cmpgt_epi8(_mm_setzero_si128(), x));
+    return sse2_widen_32_to_64(_mm_unpacklo_epi16(x, _mm_srai_epi16(x, 15)));
+}
+
+SSE2 static inline __m128i sse2_widen2(const int16_t *p) {
+    __m128i x = _mm_cvtsi32_si128(load_unaligned<int32_t>(p));
+    return sse2_widen_32_to_64(_mm_unpacklo_epi16(x, _mm_srai_epi16(x, 15)));
+}
+
+SSE2 static inline __m128i sse2_widen2(const int32_t *p) {
+    return sse2_widen_32_to_64(_mm_loadl_epi64((const __m128i *) p));
+}
+
+SSE2 static inline __m128i sse2_widen2(const int64_t *p) {
+    return _mm_loadu_si128((const __m128i *) p);
+}
+
+SSE2 static inline __m128 simd_load(const float *p, __m128) { return _mm_loadu_ps(p); }
+SSE2 static inline __m128d simd_load(const double *p, __m128d) { return _mm_loadu_pd(p); }
+SSE2 static inline __m128 simd_add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+SSE2 static inline __m128d simd_add(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+SSE2 static inline __m128 simd_sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+SSE2 static inline __m128d simd_sub(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+
+
+//AVX2: 4 lanes of 64 bit integers, 8 floats or 4 doubles
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2_widen4(const int8_t *p) {
+    return _mm256_cvtepi8_epi64(_mm_cvtsi32_si128(load_unaligned<int32_t>(p)));
+}
+
+AVX2 static inline __m256i avx2_widen4(const int16_t *p) {
+    return _mm256_cvtepi16_epi64(_mm_loadl_epi64((const __m128i *) p));
+}
+
+AVX2 static inline __m256i avx2_widen4(const int32_t *p) {
+    return _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *) p));
+}
+
+AVX2 static inline __m256i avx2_widen4(const int64_t *p) {
+    return _mm256_loadu_si256((const __m256i *) p);
+}
+
+AVX2 static inline __m256 simd_load(const float *p, __m256) { return _mm256_loadu_ps(p); }
+AVX2 static inline __m256d simd_load(const double *p, __m256d) { return _mm256_loadu_pd(p); }
+AVX2 static inline __m256 simd_add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+AVX2 static inline __m256d simd_add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+AVX2 static inline __m256 simd_sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+AVX2 static inline __m256d simd_sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+
+
+//AVX-512: 8 lanes of 64 bit integers, 16 floats or 8 doubles
+
+#define AVX512 __attribute__((target("avx512f")))
+
+AVX512 static inline __m512i avx512_widen8(const int8_t *p) {
+    return _mm512_cvtepi8_epi64(_mm_loadl_epi64((const __m128i *) p));
+}
+
+AVX512 static inline __m512i avx512_widen8(const int16_t *p) {
+    return _mm512_cvtepi16_epi64(_mm_loadu_si128((const __m128i *) p));
+}
+
+AVX512 static inline __m512i avx512_widen8(const int32_t *p) {
+    return _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i *) p));
+}
+
+AVX512 static inline __m512i avx512_widen8(const int64_t *p) {
+    return _mm512_loadu_si512(p);
+}
+
+AVX512 static inline __m512 simd_load(const float *p, __m512) { return _mm512_loadu_ps(p); }
+AVX512 static inline __m512d simd_load(const double *p, __m512d) { return _mm512_loadu_pd(p); }
+AVX512 static inline __m512 simd_add(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+AVX512 static inline __m512d simd_add(__m512d a, __m512d b) { return _mm512_add_pd(a, b); }
+AVX512 static inline __m512 simd_sub(__m512 a, __m512 b) { return _mm512_sub_ps(a, b); }
+AVX512 static inline __m512d simd_sub(__m512d a, __m512d b) { return _mm512_sub_pd(a, b); }
+
+
+//Kahan summation lane by lane, the lanes (and their compensations) are then combined in double, V is the
+//vector type of the instruction set, it has to be defined once per target since the vector operations
+//can only be inlined into a function compiled for the same target
+#define DEFINE_KAHAN_REDUCE(name, target) \
+template<class V, class T> \
+target static inline long long name(const T *values, long long low, long long high) { \
+    const long long lanes = sizeof(V) / sizeof(T); \
+    V sum = V(), compensation = V(); \
+    long long i = low; \
+    for(; i + lanes <= high; i += lanes) { \
+        V y = simd_sub(simd_load(values + i, V()), compensation); \
+        V t = simd_add(sum, y); \
+        compensation = simd_sub(simd_sub(t, sum), y); \
+        sum = t; \
+    } \
+    T sum_lanes[lanes], compensation_lanes[lanes]; \
+    memcpy(sum_lanes, &sum, sizeof(sum)); \
+    memcpy(compensation_lanes, &compensation, sizeof(compensation)); \
+    kahan_sum kahan; \
+    for(long long lane = 0; lane < lanes; lane++) { \
+        kahan.add(sum_lanes[lane]); \
+        kahan.add(-(double) compensation_lanes[lane]); \
+    } \
+    return reduce_scalar_tail(values, i, high, 0, kahan); \
+}
+
+DEFINE_KAHAN_REDUCE(sse2_kahan_reduce, SSE2)
+DEFINE_KAHAN_REDUCE(avx2_kahan_reduce, AVX2)
+DEFINE_KAHAN_REDUCE(avx512_kahan_reduce, AVX512)
+
+template<class T>
+SSE2 long long reduce_sse2(const void *data, long long low, long long high) {
+    const T *values = (const T *) data;
+    if constexpr(std::is_same<T, float>::value) {
+        return sse2_kahan_reduce<__m128>(values, low, high);
+    } else if constexpr(std::is_same<T, double>::value) {
+        return sse2_kahan_reduce<__m128d>(values, low, high);
+    } else {
+        __m128i sum0 = _mm_setzero_si128(), sum1 = _mm_setzero_si128();
+        long long i = low;
+        for(; i + 4 <= high; i += 4) {
+            sum0 = _mm_add_epi64(sum0, sse2_widen2(values + i));
+            sum1 = _mm_add_epi64(sum1, sse2_widen2(values + i + 2));
+        }
+        int64_t lanes[2];
+        _mm_storeu_si128((__m128i *) lanes, _mm_add_epi64(sum0, sum1));
+        kahan_sum unused;
+        return reduce_scalar_tail(values, i, high, lanes[0] + lanes[1], unused);
+    }
+}
+
+template<class T>
+AVX2 long long reduce_avx2(const void *data, long long low, long long high) {
+    const T *values = (const T *) data;
+    if constexpr(std::is_same<T, float>::value) {
+        return avx2_kahan_reduce<__m256>(values, low, high);
+    } else if constexpr(std::is_same<T, double>::value) {
+        return avx2_kahan_reduce<__m256d>(values, low, high);
+    } else {
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = _mm256_setzero_si256();
+        long long i = low;
+        for(; i + 8 <= high; i += 8) {
+            sum0 = _mm256_add_epi64(sum0, avx2_widen4(values + i));
+            sum1 = _mm256_add_epi64(sum1, avx2_widen4(values + i + 4));
+        }
+        int64_t lanes[4];
+        _mm256_storeu_si256((__m256i *) lanes, _mm256_add_epi64(sum0, sum1));
+        kahan_sum unused;
+        return reduce_scalar_tail(values, i, high, lanes[0] + lanes[1] + lanes[2] + lanes[3], unused);
+    }
+}
+
+template<class T>
+AVX512 long long reduce_avx512(const void *data, long long low, long long high) {
+    const T *values = (const T *) data;
+    if constexpr(std::is_same<T, float>::value) {
+        return avx512_kahan_reduce<__m512>(values, low, high);
+    } else if constexpr(std::is_same<T, double>::value) {
+        return avx512_kahan_reduce<__m512d>(values, low, high);
+    } else {
+        __m512i sum0 = _mm512_setzero_si512(), sum1 = _mm512_setzero_si512();
+        long long i = low;
+        for(; i + 16 <= high; i += 16) {
+            sum0 = _mm512_add_epi64(sum0, avx512_widen8(values + i));
+            sum1 = _mm512_add_epi64(sum1, avx512_widen8(values + i + 8));
+        }
+        int64_t lanes[8];
+        _mm512_storeu_si512(lanes, _mm512_add_epi64(sum0, sum1));
+        long long partial = 0;
+        for(int lane = 0; lane < 8; lane++) partial += lanes[lane];
+        kahan_sum unused;
+        return reduce_scalar_tail(values, i, high, partial, unused);
+    }
+}
+
+#undef SSE2
+#undef AVX2
+#undef AVX512
+#undef DEFINE_KAHAN_REDUCE
+
+//the kernel for an element type (ELEMENT_INT8 to ELEMENT_DOUBLE) and instruction set, NULL for an unknown type
+static inline reduce_kernel_p select_reduce_kernel(uint32_t element_type, simd_isa isa) {
+    static const reduce_kernel_p kernels[ELEMENT_DOUBLE][NO_OF_ISAS] = {
+        {&reduce_scalar<int8_t>, &reduce_sse2<int8_t>, &reduce_avx2<int8_t>, &reduce_avx512<int8_t>},
+        {&reduce_scalar<int16_t>, &reduce_sse2<int16_t>, &reduce_avx2<int16_t>, &reduce_avx512<int16_t>},
+        {&reduce_scalar<int32_t>, &reduce_sse2<int32_t>, &reduce_avx2<int32_t>, &reduce_avx512<int32_t>},
+        {&reduce_scalar<int64_t>, &reduce_sse2<int64_t>, &reduce_avx2<int64_t>, &reduce_avx512<int64_t>},
+        {&reduce_scalar<float>, &reduce_sse2<float>, &reduce_avx2<float>, &reduce_avx512<float>},
+        {&reduce_scalar<double>, &reduce_sse2<double>, &reduce_avx2<double>, &reduce_avx512<double>}
+    };
+    if(element_type < ELEMENT_INT8 || element_type > ELEMENT_DOUBLE) return NULL;
+    return kernels[element_type - 1][isa];
+}
+
+#endif
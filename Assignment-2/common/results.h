@@ -0,0 +1,306 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include<getopt.h>
+#include<unistd.h>
+#include<sys/utsname.h>
+#include<time.h>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<map>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+#include<iomanip>
+#include "bench_harness.h"
+#include "perf_counters.h"
+
+#define RESULTS_DEFAULT_FILE "results.csv"
+#define RESULTS_REGRESSION_THRESHOLD 0.05
+
+//the machine the results were measured on, repeated in every record so that files from different hosts
+//can be concatenated and still be told apart
+struct host_info {
+    std::string hostname, kernel, cpu_model, timestamp;
+    long no_of_cpus = 0;
+
+    void collect() {
+        char name[256] = "unknown";
+        gethostname(name, sizeof(name) - 1);
+        hostname = name;
+
+        struct utsname uts;
+        if(uname(&uts) == 0) kernel = std::string(uts.sysname) + " " + uts.release + " " + uts.machine;
+
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while(std::getline(cpuinfo, line)) {
+            if(line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+                cpu_model = line.substr(line.find(':') + 2);
+                break;
+            }
+        }
+        no_of_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        char buffer[32];
+        time_t now = time(NULL);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+        timestamp = buffer;
+    }
+};
+
+//all repeats of one strategy at one thread count, the experiment names the other parameters of the run
+struct result_entry {
+    std::string experiment, strategy;
+    int threads;
+    bench_stats stats;
+    bool has_counters;
+    perf_counts counters;
+    //mean time of the 1 thread run of the same experiment and strategy over this one, NAN if there is none
+    double speedup = NAN, efficiency = NAN;
+    //bytes of input streamed by one run, NAN if the workload is not a streaming one
+    double bytes = NAN;
+};
+
+//the records of one program run, written as one row (or JSON object) per repeat
+struct result_set {
+
+    std::string program, input;
+    long long problem_size = 0;
+    host_info host;
+    std::vector<result_entry> entries;
+
+    void add(const std::string &experiment, const std::string &strategy, int threads, const bench_stats &stats,
+             const perf_counts *counters, double bytes = NAN) {
+        result_entry entry;
+        entry.experiment = experiment;
+        entry.strategy = strategy;
+        entry.threads = threads;
+        entry.stats = stats;
+        entry.has_counters = (counters != NULL);
+        if(counters != NULL) entry.counters = *counters;
+        entry.bytes = bytes;
+        entries.push_back(entry);
+    }
+
+    void compute_speedup() {
+        std::map<std::pair<std::string, std::string>, double> serial_time;
+        for(auto &entry : entries)
+            if(entry.threads == 1) serial_time[{entry.experiment, entry.strategy}] = entry.stats.mean;
+        for(auto &entry : entries) {
+            auto serial = serial_time.find({entry.experiment, entry.strategy});
+            if(serial == serial_time.end() || entry.stats.mean <= 0) continue;
+            entry.speedup = serial->second / entry.stats.mean;
+            entry.efficiency = entry.speedup / entry.threads;
+        }
+    }
+
+    //field names and values in column order
+    typedef std::vector<std::pair<std::string, std::string>> record;
+
+    static std::string number(double value, int precision = 9) {
+        if(!std::isfinite(value)) return "";
+        std::ostringstream out;
+        out << std::setprecision(precision) << value;
+        return out.str();
+    }
+
+    std::vector<record> records() {
+        std::vector<record> rows;
+        for(auto &entry : entries) {
+            for(size_t repeat = 0; repeat < entry.stats.samples.size(); repeat++) {
+                record row = {
+                    {"program", program}, {"input", input}, {"problem_size", std::to_string(problem_size)},
+                    {"hostname", host.hostname}, {"cpu_model", host.cpu_model}, {"no_of_cpus", std::to_string(host.no_of_cpus)},
+                    {"kernel", host.kernel}, {"timestamp", host.timestamp},
+                    {"experiment", entry.experiment}, {"strategy", entry.strategy}, {"threads", std::to_string(entry.threads)},
+                    {"repeat", std::to_string(repeat)}, {"time", number(entry.stats.samples[repeat])},
+                    {"outlier", entry.stats.outlier[repeat] ? "1" : "0"},
+                    {"mean", number(entry.stats.mean)}, {"median", number(entry.stats.median)},
+                    {"p90", number(entry.stats.p90)}, {"p99", number(entry.stats.p99)},
+                    {"stddev", number(entry.stats.stddev)}, {"ci_half_width", number(entry.stats.ci_half_width)},
+                    {"converged", entry.stats.converged ? "1" : "0"},
+                    {"speedup", number(entry.speedup, 6)}, {"efficiency", number(entry.efficiency, 6)},
+                    {"gbytes_per_s", number(entry.bytes / entry.stats.mean / 1e9, 6)}
+                };
+                for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++) {
+                    double value = entry.has_counters ? entry.counters.value[event_no] : -1;
+                    row.push_back({perf_event_names[event_no], value < 0 ? "" : number(value, 15)});
+                }
+                rows.push_back(row);
+            }
+        }
+        return rows;
+    }
+
+    static std::string csv_field(const std::string &value) {
+        if(value.find_first_of(",\"\n") == std::string::npos) return value;
+        std::string quoted = "\"";
+        for(char c : value) {
+            if(c == '"') quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    static std::string json_string(const std::string &value) {
+        std::string quoted = "\"";
+        for(char c : value) {
+            if(c == '"' || c == '\\') quoted += '\\';
+            if((unsigned char) c < ' ') continue;
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    void write_csv(std::ostream &out) {
+        std::vector<record> rows = records();
+        if(rows.empty()) return;
+        for(size_t column = 0; column < rows[0].size(); column++)
+            out << (column ? "," : "") << rows[0][column].first;
+        out << "\n";
+        for(auto &row : rows) {
+            for(size_t column = 0; column < row.size(); column++)
+                out << (column ? "," : "") << csv_field(row[column].second);
+            out << "\n";
+        }
+    }
+
+    //a JSON array of flat objects, numeric fields are written as numbers and missing ones as null
+    void write_json(std::ostream &out) {
+        static const std::vector<std::string> string_fields = {"program", "input", "hostname", "cpu_model", "kernel",
+                                                               "timestamp", "experiment", "strategy"};
+        std::vector<record> rows = records();
+        out << "[\n";
+        for(size_t row_no = 0; row_no < rows.size(); row_no++) {
+            out << "  {";
+            for(size_t column = 0; column < rows[row_no].size(); column++) {
+                auto &field = rows[row_no][column];
+                bool is_string = false;
+                for(auto &name : string_fields) is_string |= (name == field.first);
+                out << (column ? ", " : "") << json_string(field.first) << ": ";
+                if(is_string) out << json_string(field.second);
+                else out << (field.second.empty() ? "null" : field.second);
+            }
+            out << (row_no + 1 < rows.size() ? "},\n" : "}\n");
+        }
+        out << "]\n";
+    }
+
+    //writes JSON if the file name ends in .json and CSV otherwise
+    bool write(const std::string &path) {
+        std::ofstream out(path);
+        if(!out.is_open()) return false;
+        if(path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0) write_json(out);
+        else write_csv(out);
+        return out.good();
+    }
+};
+
+//splits one CSV line, quoted fields may contain commas and doubled quotes but no newlines
+static inline std::vector<std::string> split_csv_line(const std::string &line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for(size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if(quoted) {
+            if(c == '"' && i + 1 < line.size() && line[i + 1] == '"') fields.back() += line[++i];
+            else if(c == '"') quoted = false;
+            else fields.back() += c;
+        } else if(c == '"') {
+            quoted = true;
+        } else if(c == ',') {
+            fields.emplace_back();
+        } else if(c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+//compares the median time of every (experiment, strategy, threads) against the same key in a results CSV
+//written by an earlier run, prints the ones that got slower by more than threshold (a fraction) and
+//returns their number, or -1 if the baseline could not be read
+static inline int compare_with_baseline(const result_set &results, const std::string &path, double threshold) {
+    std::ifstream in(path);
+    std::string line;
+    if(!in.is_open() || !std::getline(in, line)) return -1;
+
+    std::vector<std::string> header = split_csv_line(line);
+    std::map<std::string, size_t> column;
+    for(size_t i = 0; i < header.size(); i++) column[header[i]] = i;
+    for(const char *name : {"experiment", "strategy", "threads", "time"})
+        if(column.find(name) == column.end()) return -1;
+
+    std::map<std::string, std::vector<double>> baseline_samples;
+    while(std::getline(in, line)) {
+        std::vector<std::string> fields = split_csv_line(line);
+        if(fields.size() != header.size()) continue;
+        std::string key = fields[column["experiment"]] + "|" + fields[column["strategy"]] + "|" + fields[column["threads"]];
+        baseline_samples[key].push_back(atof(fields[column["time"]].c_str()));
+    }
+
+    int no_of_regressions = 0, no_of_compared = 0;
+    std::cout << "Comparison with baseline " << path << " (median time, regression threshold "
+              << std::fixed << std::setprecision(1) << threshold * 100 << "%):\n";
+    for(auto &entry : results.entries) {
+        auto baseline = baseline_samples.find(entry.experiment + "|" + entry.strategy + "|" + std::to_string(entry.threads));
+        if(baseline == baseline_samples.end()) continue;
+        std::sort(baseline->second.begin(), baseline->second.end());
+        double baseline_median = percentile(baseline->second, 50);
+        double change = (baseline_median > 0) ? entry.stats.median / baseline_median - 1 : 0;
+        no_of_compared++;
+        if(change > threshold) {
+            no_of_regressions++;
+            std::cout << "\tREGRESSION " << entry.experiment << " " << entry.strategy << " " << entry.threads << " threads: "
+                      << std::setprecision(6) << baseline_median << " -> " << entry.stats.median << " ("
+                      << std::showpos << std::setprecision(1) << change * 100 << std::noshowpos << "%)\n";
+        }
+    }
+    std::cout << "\t" << no_of_regressions << " regressions in " << no_of_compared << " compared measurements\n\n";
+    return no_of_regressions;
+}
+
+//command line options for the result file and the baseline comparison, next to the harness options
+enum {
+    RESULTS_OPTION_OUTPUT = 1100,
+    RESULTS_OPTION_BASELINE,
+    RESULTS_OPTION_THRESHOLD
+};
+
+struct results_config {
+    std::string output = RESULTS_DEFAULT_FILE;
+    std::string baseline;
+    double threshold = RESULTS_REGRESSION_THRESHOLD;
+};
+
+#define RESULTS_LONG_OPTIONS \
+    {"output", required_argument, NULL, RESULTS_OPTION_OUTPUT}, \
+    {"baseline", required_argument, NULL, RESULTS_OPTION_BASELINE}, \
+    {"threshold", required_argument, NULL, RESULTS_OPTION_THRESHOLD}
+
+#define RESULTS_USAGE \
+    "\t--output FILE\t\trecords of every run, JSON if FILE ends in .json and CSV otherwise (default " RESULTS_DEFAULT_FILE ")\n" \
+    "\t--baseline FILE\t\tcompare the median times against an earlier CSV output, exit status 1 on regressions\n" \
+    "\t--threshold PCT\t\tslowdown over the baseline reported as a regression (default 5)\n"
+
+static inline bool results_parse_option(int option, const char *arg, results_config &config) {
+    char *end;
+    switch(option) {
+        case RESULTS_OPTION_OUTPUT:
+            config.output = arg;
+            return !config.output.empty();
+        case RESULTS_OPTION_BASELINE:
+            config.baseline = arg;
+            return !config.baseline.empty();
+        case RESULTS_OPTION_THRESHOLD:
+            config.threshold = strtod(arg, &end) / 100;
+            return *end == '\0' && config.threshold >= 0;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef RW_LOCKS_H
+#define RW_LOCKS_H
+
+#include<pthread.h>
+#include<atomic>
+#include<shared_mutex>
+#include "spinlock.h"
+
+//read-write locks behind one interface: read_lock() returns a token that is handed back to
+//read_unlock(), which returns false if the read has to be retried (only the seqlock ever does)
+
+struct pthread_rw_lock {
+    pthread_rwlock_t rwlock;
+
+    pthread_rw_lock() {
+        pthread_rwlock_init(&rwlock, NULL);
+    }
+
+    ~pthread_rw_lock() {
+        pthread_rwlock_destroy(&rwlock);
+    }
+
+    unsigned read_lock() {
+        pthread_rwlock_rdlock(&rwlock);
+        return 0;
+    }
+
+    bool read_unlock(unsigned) {
+        pthread_rwlock_unlock(&rwlock);
+        return true;
+    }
+
+    void write_lock() {
+        pthread_rwlock_wrlock(&rwlock);
+    }
+
+    void write_unlock() {
+        pthread_rwlock_unlock(&rwlock);
+    }
+};
+
+//glibc's rwlock prefers readers by default, this one makes new readers queue behind a waiting writer
+struct writer_preferring_rw_lock : pthread_rw_lock {
+
+    writer_preferring_rw_lock() {
+        pthread_rwlock_destroy(&rwlock);
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+        pthread_rwlock_init(&rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+};
+
+struct std_shared_mutex_lock {
+    std::shared_mutex mutex;
+
+    unsigned read_lock() {
+        mutex.lock_shared();
+        return 0;
+    }
+
+    bool read_unlock(unsigned) {
+        mutex.unlock_shared();
+        return true;
+    }
+
+    void write_lock() {
+        mutex.lock();
+    }
+
+    void write_unlock() {
+        mutex.unlock();
+    }
+};
+
+//sequence lock: writers serialise on a spinlock and make the sequence odd while they write, readers
+//never write shared memory, they just retry if the sequence was odd or changed during their read
+//the protected data must be read with (relaxed) atomics since readers race with the writer
+struct seq_lock {
+    std::atomic<unsigned> sequence{0};
+    ttas_lock writer_lock;
+
+    unsigned read_lock() {
+        unsigned seq;
+        while((seq = sequence.load(std::memory_order_acquire)) & 1)
+            cpu_relax();
+        return seq;
+    }
+
+    bool read_unlock(unsigned seq) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == seq;
+    }
+
+    void write_lock() {
+        writer_lock.lock();
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void write_unlock() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        writer_lock.unlock();
+    }
+};
+
+#endif
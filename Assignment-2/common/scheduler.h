@@ -0,0 +1,214 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include<pthread.h>
+#include<sched.h>
+#include<atomic>
+#include<vector>
+#include<algorithm>
+#include "spinlock.h"
+
+#define SCHEDULE_DEFAULT_CHUNK 4096
+
+enum schedule_mode {
+    SCHEDULE_STATIC,       //one contiguous slice per thread
+    SCHEDULE_DYNAMIC,      //fixed size chunks handed out by a shared atomic cursor
+    SCHEDULE_GUIDED,       //like dynamic, but a chunk is a share of the remaining work (never below the chunk size)
+    SCHEDULE_STEALING      //every thread starts on the chunks of its slice and steals from the others when out of them
+};
+
+[[maybe_unused]] static const char* schedule_mode_names[] = {"static", "dynamic", "guided", "stealing"};
+
+enum steal_result {
+    STEAL_OK,
+    STEAL_EMPTY,
+    STEAL_ABORT        //lost a race with the owner or another thief, the deque may still hold work
+};
+
+//Chase-Lev work stealing deque of chunk ids, following the C11 version of Le, Pop, Cohen and Zappa Nardelli
+//it is filled before the run (the pool dispatch orders that before the workers start) and never grows, so
+//only pop (by the owner, at the bottom) and steal (by anybody, at the top) are needed
+struct chase_lev_deque {
+
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<long long> top;
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<long long> bottom;
+    std::vector<std::atomic<long long>> buffer;
+
+    void fill(const std::vector<long long> &ids) {
+        buffer = std::vector<std::atomic<long long>>(std::max((size_t) 1, ids.size()));
+        for(size_t index = 0; index < ids.size(); index++)
+            buffer[index].store(ids[index], std::memory_order_relaxed);
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(ids.size(), std::memory_order_relaxed);
+    }
+
+    bool pop(long long &id) {
+        long long b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long t = top.load(std::memory_order_relaxed);
+        if(t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        id = buffer[b].load(std::memory_order_relaxed);
+        if(t == b) {
+            //the last element, a thief may be taking it at the same time
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    steal_result steal(long long &id) {
+        long long t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long b = bottom.load(std::memory_order_acquire);
+        if(t >= b) return STEAL_EMPTY;
+        id = buffer[t].load(std::memory_order_relaxed);
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return STEAL_ABORT;
+        return STEAL_OK;
+    }
+};
+
+//hands out the ranges [low, high) of one pass over an array of length elements, passes times over,
+//prepare() is called by the main thread before every run and next() by the workers until it returns false
+struct chunk_scheduler {
+
+    schedule_mode mode = SCHEDULE_STATIC;
+    long long length = 0, passes = 1, chunk = SCHEDULE_DEFAULT_CHUNK;
+    long long chunks_per_pass = 1;
+    int no_of_threads = 1;
+
+    alignas(SPINLOCK_CACHE_LINE) std::atomic<long long> cursor;
+
+    struct alignas(SPINLOCK_CACHE_LINE) rank_state {
+        long long taken;
+    };
+    std::vector<rank_state> state;
+    std::vector<chase_lev_deque> deques;
+
+    //the first and one past the last chunk of the static slice of my_rank, in whole chunks
+    void slice_chunks(int my_rank, long long &first, long long &last) {
+        long long my_block = (chunks_per_pass + no_of_threads - 1) / no_of_threads;
+        first = std::min(my_block * my_rank, chunks_per_pass);
+        last = std::min(first + my_block, chunks_per_pass);
+    }
+
+    void prepare(schedule_mode schedule, long long elements, long long no_of_passes, long long chunk_size, int threads) {
+        mode = schedule;
+        length = elements;
+        passes = no_of_passes;
+        no_of_threads = threads;
+        //the static slices keep the split the strategies always used, one chunk per thread and pass
+        chunk = (mode == SCHEDULE_STATIC) ? (length + threads - 1) / threads : std::max(1LL, chunk_size);
+        chunks_per_pass = (length + chunk - 1) / chunk;
+        cursor.store(0, std::memory_order_relaxed);
+        state.assign(threads, rank_state{0});
+
+        if(mode == SCHEDULE_STEALING) {
+            if((int) deques.size() < threads) deques = std::vector<chase_lev_deque>(threads);
+            for(int rank = 0; rank < threads; rank++) {
+                long long first, last;
+                slice_chunks(rank, first, last);
+                //the chunk ids of every pass of the slice, id = pass * chunks_per_pass + chunk
+                std::vector<long long> ids;
+                for(long long pass = 0; pass < passes; pass++)
+                    for(long long chunk_no = first; chunk_no < last; chunk_no++)
+                        ids.push_back(pass * chunks_per_pass + chunk_no);
+                deques[rank].fill(ids);
+            }
+        }
+    }
+
+    bool chunk_range(long long id, long long &low, long long &high) {
+        low = (id % chunks_per_pass) * chunk;
+        high = std::min(low + chunk, length);
+        return true;
+    }
+
+    bool next(int my_rank, long long &low, long long &high) {
+        switch(mode) {
+            case SCHEDULE_STATIC: {
+                long long first, last;
+                slice_chunks(my_rank, first, last);
+                long long taken = state[my_rank].taken++;
+                if(first == last || taken >= passes) return false;
+                return chunk_range(first, low, high);
+            }
+            case SCHEDULE_DYNAMIC: {
+                long long id = cursor.fetch_add(1, std::memory_order_relaxed);
+                if(id >= passes * chunks_per_pass) return false;
+                return chunk_range(id, low, high);
+            }
+            case SCHEDULE_GUIDED: {
+                //the cursor counts elements over all passes, a chunk never crosses the end of a pass
+                long long total = passes * length;
+                long long start = cursor.load(std::memory_order_relaxed), size;
+                do {
+                    if(start >= total) return false;
+                    size = std::max(chunk, (total - start) / (2 * no_of_threads));
+                    size = std::min(size, (start / length + 1) * length - start);
+                } while(!cursor.compare_exchange_weak(start, start + size, std::memory_order_relaxed));
+                low = start % length;
+                high = low + size;
+                return true;
+            }
+            case SCHEDULE_STEALING: {
+                long long id;
+                if(deques[my_rank].pop(id)) return chunk_range(id, low, high);
+                //sweep over the other deques until one gives a chunk or all of them were seen empty
+                while(true) {
+                    bool aborted = false;
+                    for(int offset = 1; offset < no_of_threads; offset++) {
+                        steal_result result = deques[(my_rank + offset) % no_of_threads].steal(id);
+                        if(result == STEAL_OK) return chunk_range(id, low, high);
+                        aborted |= (result == STEAL_ABORT);
+                    }
+                    if(!aborted) return false;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+//threads that spin for as long as they run, to take cpu time away from some of the workers
+struct cpu_hog {
+
+    std::vector<pthread_t> threads;
+    static inline std::atomic<bool> running{false};
+
+    static void* spin(void *) {
+        while(running.load(std::memory_order_relaxed))
+            cpu_relax();
+        return NULL;
+    }
+
+    //starts no_of_hogs spinning threads, hog i pinned to cpus[i % no_of_cpus] if there are any cpus
+    void start(int no_of_hogs, const int *cpus, int no_of_cpus) {
+        running = true;
+        for(int hog = 0; hog < no_of_hogs; hog++) {
+            pthread_t thread;
+            if(pthread_create(&thread, NULL, spin, NULL) != 0) break;
+            if(no_of_cpus > 0) {
+                cpu_set_t mask;
+                CPU_ZERO(&mask);
+                CPU_SET(cpus[hog % no_of_cpus], &mask);
+                pthread_setaffinity_np(thread, sizeof(mask), &mask);
+            }
+            threads.push_back(thread);
+        }
+    }
+
+    void stop() {
+        running = false;
+        for(auto thread : threads)
+            pthread_join(thread, NULL);
+        threads.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include<atomic>
+#include<algorithm>
+
+#define SPINLOCK_CACHE_LINE 64
+#define SPINLOCK_MIN_BACKOFF 4
+#define SPINLOCK_MAX_BACKOFF 1024
+
+//tells the core that we are in a spin loop (pause on x86), which saves power and frees the
+//pipeline for the sibling hyperthread
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
+//test-and-set: every waiter keeps doing an atomic exchange, so the cache line bounces between the
+//waiting cores even while the lock is held
+struct alignas(SPINLOCK_CACHE_LINE) tas_lock {
+    std::atomic<bool> locked{false};
+
+    void lock() {
+        while(locked.exchange(true, std::memory_order_acquire))
+            cpu_relax();
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+//test-and-test-and-set: waiters spin on a plain load (the line stays shared in their caches) and only
+//try the exchange once the lock looks free, backing off exponentially after every failed attempt
+struct alignas(SPINLOCK_CACHE_LINE) ttas_lock {
+    std::atomic<bool> locked{false};
+
+    void lock() {
+        int backoff = SPINLOCK_MIN_BACKOFF;
+        while(true) {
+            while(locked.load(std::memory_order_relaxed))
+                cpu_relax();
+            if(!locked.exchange(true, std::memory_order_acquire))
+                return;
+            for(int i = 0; i < backoff; i++)
+                cpu_relax();
+            backoff = std::min(backoff * 2, SPINLOCK_MAX_BACKOFF);
+        }
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+//ticket lock: fair (FIFO) but every waiter still spins on the same now_serving counter
+struct alignas(SPINLOCK_CACHE_LINE) ticket_lock {
+    std::atomic<unsigned> next_ticket{0};
+    std::atomic<unsigned> now_serving{0};
+
+    void lock() {
+        unsigned my_ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+        while(now_serving.load(std::memory_order_acquire) != my_ticket)
+            cpu_relax();
+    }
+
+    void unlock() {
+        now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+//MCS queue lock: every waiter spins on the flag in its own node and the lock holder hands the lock
+//directly to its successor, so a release touches only one remote cache line
+//the node is thread local, so a thread can hold at most one MCS lock at a time
+struct alignas(SPINLOCK_CACHE_LINE) mcs_lock {
+    struct alignas(SPINLOCK_CACHE_LINE) node {
+        std::atomic<node*> next{nullptr};
+        std::atomic<bool> locked{false};
+    };
+
+    std::atomic<node*> tail{nullptr};
+
+    static node& my_node() {
+        static thread_local node n;
+        return n;
+    }
+
+    void lock() {
+        node *n = &my_node();
+        n->next.store(nullptr, std::memory_order_relaxed);
+        n->locked.store(true, std::memory_order_relaxed);
+        node *predecessor = tail.exchange(n, std::memory_order_acq_rel);
+        if(predecessor != nullptr) {
+            predecessor->next.store(n, std::memory_order_release);
+            while(n->locked.load(std::memory_order_acquire))
+                cpu_relax();
+        }
+    }
+
+    void unlock() {
+        node *n = &my_node();
+        node *successor = n->next.load(std::memory_order_acquire);
+        if(successor == nullptr) {
+            node *expected = n;
+            if(tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel))
+                return;
+            while((successor = n->next.load(std::memory_order_acquire)) == nullptr)
+                cpu_relax();
+        }
+        successor->locked.store(false, std::memory_order_release);
+    }
+};
+
+//CLH queue lock: every waiter spins on the node of its predecessor, once it has the lock a thread takes
+//over its predecessor's node as its spare for the next acquisition (of this or any other CLH lock), so
+//nodes move between threads and locks: one rests in the tail of every lock and one is the spare of every
+//thread, freed with the lock and at the thread's exit
+struct alignas(SPINLOCK_CACHE_LINE) clh_lock {
+    struct alignas(SPINLOCK_CACHE_LINE) node {
+        std::atomic<bool> locked{false};
+    };
+
+    struct spare_node {
+        node *n = new node;
+        ~spare_node() { delete n; }
+    };
+
+    std::atomic<node*> tail{new node};
+    //the node the holder enqueued, only touched by the holder
+    alignas(SPINLOCK_CACHE_LINE) node *holder_node = nullptr;
+
+    static node*& my_spare() {
+        static thread_local spare_node spare;
+        return spare.n;
+    }
+
+    ~clh_lock() {
+        delete tail.load();
+    }
+
+    void lock() {
+        node *n = my_spare();
+        n->locked.store(true, std::memory_order_relaxed);
+        node *predecessor = tail.exchange(n, std::memory_order_acq_rel);
+        while(predecessor->locked.load(std::memory_order_acquire))
+            cpu_relax();
+        //nobody else looks at the predecessor's node any more
+        my_spare() = predecessor;
+        holder_node = n;
+    }
+
+    void unlock() {
+        holder_node->locked.store(false, std::memory_order_release);
+    }
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef STENCIL_KERNELS_H
+#define STENCIL_KERNELS_H
+
+#include<immintrin.h>
+#include "reduce_kernels.h"
+
+//one time step of the 1D heat stencil on the cells [low, high) of a rod of no_of_cells cells:
+//  next[cell] = old[cell] + (old[cell - 1] - old[cell]) * coefficient + (old[cell + 1] - old[cell]) * coefficient
+//where the ends of the rod lack the missing neighbour's term, the elements are floats or doubles
+//every kernel does the same operations in the same order (no fused multiply-add, build with -ffp-contract=off
+//or the compiler fuses them in the avx512 kernels), so all of them produce
+//bit-identical results
+typedef void (*stencil_kernel_p) (const void *old, void *next, long long low, long long high, long long no_of_cells,
+                                  double coefficient);
+
+enum stencil_precision {
+    PRECISION_DOUBLE,
+    PRECISION_FLOAT
+};
+
+[[maybe_unused]] static const char* stencil_precision_names[] = {"double", "float"};
+
+//a cell, the template arguments say which neighbours it has, so that the interior loop carries no branch and
+//the ends of the rod are peeled off through the specialisations
+template<class T, bool has_left, bool has_right>
+struct stencil_cell {
+    static inline T update(const T *old, long long cell, T coefficient) {
+        T value = old[cell];
+        value += (old[cell - 1] - old[cell]) * coefficient;
+        value += (old[cell + 1] - old[cell]) * coefficient;
+        return value;
+    }
+};
+
+template<class T>
+struct stencil_cell<T, false, true> {
+    static inline T update(const T *old, long long cell, T coefficient) {
+        return old[cell] + (old[cell + 1] - old[cell]) * coefficient;
+    }
+};
+
+template<class T>
+struct stencil_cell<T, true, false> {
+    static inline T update(const T *old, long long cell, T coefficient) {
+        return old[cell] + (old[cell - 1] - old[cell]) * coefficient;
+    }
+};
+
+template<class T>
+struct stencil_cell<T, false, false> {
+    static inline T update(const T *old, long long cell, T) {
+        return old[cell];
+    }
+};
+
+//updates the ends of the rod that fall into [low, high) and narrows the range to the interior cells
+template<class T>
+static inline void stencil_peel(const T *old, T *next, long long &low, long long &high, long long no_of_cells, T coefficient) {
+    if(low == 0 && high > 0) {
+        next[0] = (no_of_cells == 1) ? stencil_cell<T, false, false>::update(old, 0, coefficient)
+                                     : stencil_cell<T, false, true>::update(old, 0, coefficient);
+        low = 1;
+    }
+    if(high == no_of_cells && high > low) {
+        next[high - 1] = stencil_cell<T, true, false>::update(old, high - 1, coefficient);
+        high--;
+    }
+}
+
+template<class T>
+static inline void stencil_interior_scalar(const T *old, T *next, long long low, long long high, T coefficient) {
+    for(long long cell = low; cell < high; cell++)
+        next[cell] = stencil_cell<T, true, true>::update(old, cell, coefficient);
+}
+
+template<class T>
+void stencil_scalar(const void *old_data, void *next_data, long long low, long long high, long long no_of_cells, double coefficient) {
+    const T *old = (const T *) old_data;
+    T *next = (T *) next_data;
+    stencil_peel(old, next, low, high, no_of_cells, (T) coefficient);
+    stencil_interior_scalar(old, next, low, high, (T) coefficient);
+}
+
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+SSE2 static inline __m128 simd_mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+SSE2 static inline __m128d simd_mul(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+SSE2 static inline __m128 simd_set1(float value, __m128) { return _mm_set1_ps(value); }
+SSE2 static inline __m128d simd_set1(double value, __m128d) { return _mm_set1_pd(value); }
+SSE2 static inline void simd_store(float *p, __m128 value) { _mm_storeu_ps(p, value); }
+SSE2 static inline void simd_store(double *p, __m128d value) { _mm_storeu_pd(p, value); }
+
+AVX2 static inline __m256 simd_mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+AVX2 static inline __m256d simd_mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+AVX2 static inline __m256 simd_set1(float value, __m256) { return _mm256_set1_ps(value); }
+AVX2 static inline __m256d simd_set1(double value, __m256d) { return _mm256_set1_pd(value); }
+AVX2 static inline void simd_store(float *p, __m256 value) { _mm256_storeu_ps(p, value); }
+AVX2 static inline void simd_store(double *p, __m256d value) { _mm256_storeu_pd(p, value); }
+
+AVX512 static inline __m512 simd_mul(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+AVX512 static inline __m512d simd_mul(__m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+AVX512 static inline __m512 simd_set1(float value, __m512) { return _mm512_set1_ps(value); }
+AVX512 static inline __m512d simd_set1(double value, __m512d) { return _mm512_set1_pd(value); }
+AVX512 static inline void simd_store(float *p, __m512 value) { _mm512_storeu_ps(p, value); }
+AVX512 static inline void simd_store(double *p, __m512d value) { _mm512_storeu_pd(p, value); }
+
+//the interior cells a vector at a time (the neighbours are the same vector loaded one cell to the left and to
+//the right), the last partial vector goes through the scalar cells, defined once per target like the reductions
+#define DEFINE_STENCIL_KERNEL(name, target) \
+template<class V, class T> \
+target void name(const void *old_data, void *next_data, long long low, long long high, long long no_of_cells, double coefficient) { \
+    const long long lanes = sizeof(V) / sizeof(T); \
+    const T *old = (const T *) old_data; \
+    T *next = (T *) next_data; \
+    stencil_peel(old, next, low, high, no_of_cells, (T) coefficient); \
+    V factor = simd_set1((T) coefficient, V()); \
+    long long cell = low; \
+    for(; cell + lanes <= high; cell += lanes) { \
+        V center = simd_load(old + cell, V()); \
+        V value = simd_add(center, simd_mul(simd_sub(simd_load(old + cell - 1, V()), center), factor)); \
+        value = simd_add(value, simd_mul(simd_sub(simd_load(old + cell + 1, V()), center), factor)); \
+        simd_store(next + cell, value); \
+    } \
+    stencil_interior_scalar(old, next, cell, high, (T) coefficient); \
+}
+
+DEFINE_STENCIL_KERNEL(stencil_sse2, SSE2)
+DEFINE_STENCIL_KERNEL(stencil_avx2, AVX2)
+DEFINE_STENCIL_KERNEL(stencil_avx512, AVX512)
+
+#undef SSE2
+#undef AVX2
+#undef AVX512
+#undef DEFINE_STENCIL_KERNEL
+
+static inline stencil_kernel_p select_stencil_kernel(stencil_precision precision, simd_isa isa) {
+    static const stencil_kernel_p kernels[2][NO_OF_ISAS] = {
+        {&stencil_scalar<double>, &stencil_sse2<__m128d, double>, &stencil_avx2<__m256d, double>, &stencil_avx512<__m512d, double>},
+        {&stencil_scalar<float>, &stencil_sse2<__m128, float>, &stencil_avx2<__m256, float>, &stencil_avx512<__m512, float>}
+    };
+    return kernels[precision][isa];
+}
+
+#endif
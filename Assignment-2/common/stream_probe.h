@@ -0,0 +1,64 @@
+#ifndef STREAM_PROBE_H
+#define STREAM_PROBE_H
+
+#include<sys/mman.h>
+#include<algorithm>
+#include "thread_pool.h"
+
+#define STREAM_DEFAULT_MB 64
+#define STREAM_REPEAT 5
+
+//STREAM style triad a[i] = b[i] + scalar * c[i] over three arrays much larger than the caches, run on the
+//workers of a pool, the best of STREAM_REPEAT runs gives the memory bandwidth the sums can be compared to
+struct stream_probe {
+
+    static inline double *a, *b, *c;
+    static inline long long length;
+    static inline int no_of_threads;
+
+    static void* triad(void *arg) {
+        int my_rank = *((int*) arg);
+        long long my_block = (length + no_of_threads - 1) / no_of_threads;
+        long long my_low = std::min(my_block * my_rank, length);
+        long long my_high = std::min(my_low + my_block, length);
+        for(long long i = my_low; i < my_high; i++)
+            a[i] = b[i] + 3.0 * c[i];
+        return NULL;
+    }
+
+    //each worker first touches its own part of the arrays, as the triad runs will
+    static void* init(void *arg) {
+        int my_rank = *((int*) arg);
+        long long my_block = (length + no_of_threads - 1) / no_of_threads;
+        long long my_low = std::min(my_block * my_rank, length);
+        long long my_high = std::min(my_low + my_block, length);
+        for(long long i = my_low; i < my_high; i++) {
+            a[i] = 0;
+            b[i] = 1;
+            c[i] = 2;
+        }
+        return NULL;
+    }
+
+    //bytes moved per second (two arrays read, one written), 0 if the arrays could not be allocated
+    static double measure(thread_pool &pool, int threads, long long megabytes_per_array) {
+        length = megabytes_per_array * (1 << 20) / sizeof(double);
+        no_of_threads = threads;
+        size_t bytes = length * sizeof(double);
+        void *arrays = mmap(NULL, 3 * bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(arrays == MAP_FAILED || length == 0) return 0;
+        a = (double *) arrays;
+        b = a + length;
+        c = b + length;
+
+        pool.run(init, threads);
+        double best_time = DBL_MAX;
+        for(int repeat = 0; repeat < STREAM_REPEAT; repeat++)
+            best_time = std::min(best_time, pool.run(triad, threads));
+
+        munmap(arrays, 3 * bytes);
+        return 3.0 * bytes / best_time;
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include<pthread.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<cerrno>
+#include<vector>
+#include<algorithm>
+#include "bench_harness.h"
+
+//a ring of no_of_buffers reusable buffers through which a file section is streamed in blocks of block_bytes:
+//reader threads claim the blocks in order and pread block k into buffer k % no_of_buffers once block
+//k - no_of_buffers has been released from it, compute threads claim the blocks in the same order and wait until
+//theirs has been read, so at most no_of_buffers blocks are in memory whatever the size of the file
+//blocks change hands rarely (every few MB), so one mutex and condition variable are enough
+struct stream_ring {
+
+    int fd = -1;
+    off_t data_offset = 0;
+    long long total_bytes = 0, no_of_blocks = 0;
+    size_t block_bytes = 0;
+    int no_of_buffers = 0;
+    char *memory = NULL;
+
+    //the block each buffer holds (or -1) and the last block released from it
+    std::vector<long long> filled, released;
+    long long next_read = 0, next_compute = 0;
+    bool read_error = false;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+
+    bool open(int file, off_t offset, long long bytes, size_t block_size, int buffers) {
+        fd = file;
+        data_offset = offset;
+        total_bytes = bytes;
+        block_bytes = block_size;
+        no_of_buffers = buffers;
+        no_of_blocks = (total_bytes + block_bytes - 1) / block_bytes;
+        memory = (char *) mmap(NULL, block_bytes * no_of_buffers, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory == MAP_FAILED) {
+            memory = NULL;
+            return false;
+        }
+        posix_fadvise(fd, data_offset, total_bytes, POSIX_FADV_SEQUENTIAL);
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&changed, NULL);
+        reset();
+        return true;
+    }
+
+    void close() {
+        if(memory == NULL) return;
+        munmap(memory, block_bytes * no_of_buffers);
+        memory = NULL;
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&changed);
+    }
+
+    //before every pass over the file, while no thread uses the ring
+    void reset() {
+        filled.assign(no_of_buffers, -1);
+        released.resize(no_of_buffers);
+        for(int buffer = 0; buffer < no_of_buffers; buffer++)
+            released[buffer] = buffer - no_of_buffers;
+        next_read = next_compute = 0;
+        read_error = false;
+    }
+
+    //reads the next unclaimed block, false once all blocks are claimed, io_time gets the seconds spent in pread
+    bool read_next(double &io_time) {
+        pthread_mutex_lock(&mutex);
+        if(next_read >= no_of_blocks) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        long long block = next_read++;
+        int buffer = block % no_of_buffers;
+        while(released[buffer] != block - no_of_buffers)
+            pthread_cond_wait(&changed, &mutex);
+        pthread_mutex_unlock(&mutex);
+
+        double start = monotonic_time();
+        char *data = memory + buffer * block_bytes;
+        long long first_byte = block * block_bytes;
+        size_t bytes = std::min((long long) block_bytes, total_bytes - first_byte), done = 0;
+        bool error = false;
+        while(done < bytes) {
+            ssize_t got = pread(fd, data + done, bytes - done, data_offset + first_byte + done);
+            if(got < 0 && errno == EINTR) continue;
+            if(got <= 0) {
+                error = true;
+                break;
+            }
+            done += got;
+        }
+        io_time += monotonic_time() - start;
+
+        pthread_mutex_lock(&mutex);
+        filled[buffer] = block;
+        read_error |= error;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+
+    //waits for the next unclaimed block to be read, false once all blocks are claimed
+    bool acquire_next(long long &block, const char *&data, size_t &bytes) {
+        pthread_mutex_lock(&mutex);
+        if(next_compute >= no_of_blocks) {
+            pthread_mutex_unlock(&mutex);
+            return false;
+        }
+        block = next_compute++;
+        int buffer = block % no_of_buffers;
+        while(filled[buffer] != block)
+            pthread_cond_wait(&changed, &mutex);
+        pthread_mutex_unlock(&mutex);
+
+        data = memory + buffer * block_bytes;
+        bytes = std::min((long long) block_bytes, total_bytes - block * (long long) block_bytes);
+        return true;
+    }
+
+    void release(long long block) {
+        pthread_mutex_lock(&mutex);
+        released[block % no_of_buffers] = block;
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+#endif
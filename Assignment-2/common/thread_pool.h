@@ -0,0 +1,145 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include<pthread.h>
+#include<sched.h>
+#include<semaphore.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#include<cfloat>
+#include "bench_harness.h"
+
+typedef void* (*pool_job_p) (void *);
+
+//a fixed set of worker threads which are created once and then dispatched for every run
+//each worker waits on its own start semaphore and reports back on the shared done semaphore,
+//so the cost of creating the threads stays out of the measured runs
+struct thread_pool {
+
+    struct worker_arg {
+        thread_pool *pool;
+        int rank;
+    };
+
+    int no_of_workers = 0;
+    pthread_t *threads = NULL;
+    worker_arg *args = NULL;
+    pid_t *tid = NULL;
+    sem_t *start_sem = NULL;
+    sem_t done_sem;
+
+    pool_job_p job = NULL;
+    bool stop_flag = false;
+    double *job_begin = NULL, *job_end = NULL;
+
+    //wall time taken to create all the workers and have each of them reach its wait loop
+    double startup_time = 0;
+
+    static double wall_time() {
+        return monotonic_time();
+    }
+
+    static void* worker(void *arg) {
+        thread_pool *pool = ((worker_arg*) arg)->pool;
+        int my_rank = ((worker_arg*) arg)->rank;
+
+        pool->tid[my_rank] = syscall(SYS_gettid);
+        sem_post(&pool->done_sem);
+        while(true) {
+            while(sem_wait(&pool->start_sem[my_rank]));
+            if(pool->stop_flag) break;
+            pool->job_begin[my_rank] = wall_time();
+            pool->job((void *) (&pool->args[my_rank].rank));
+            pool->job_end[my_rank] = wall_time();
+            sem_post(&pool->done_sem);
+        }
+
+        return NULL;
+    }
+
+    //creates the workers, returns false (after cleaning up) if any of them could not be created
+    bool start(int workers) {
+        no_of_workers = 0;
+        threads = new pthread_t[workers];
+        args = new worker_arg[workers];
+        tid = new pid_t[workers];
+        start_sem = new sem_t[workers];
+        job_begin = new double[workers];
+        job_end = new double[workers];
+        sem_init(&done_sem, 0, 0);
+
+        double start_time = wall_time();
+        for(int thread_no = 0; thread_no < workers; thread_no++) {
+            args[thread_no].pool = this;
+            args[thread_no].rank = thread_no;
+            sem_init(&start_sem[thread_no], 0, 0);
+            if(pthread_create(&threads[thread_no], NULL, worker, (void *) (&args[thread_no])) != 0) {
+                sem_destroy(&start_sem[thread_no]);
+                stop();
+                return false;
+            }
+            no_of_workers++;
+        }
+        for(int thread_no = 0; thread_no < no_of_workers; thread_no++)
+            while(sem_wait(&done_sem));
+        startup_time = wall_time() - start_time;
+
+        return true;
+    }
+
+    //pins worker rank i to cpus[i % no_of_cpus], returns false if any of them could not be pinned
+    bool pin(const int *cpus, int no_of_cpus) {
+        bool ok = true;
+        for(int thread_no = 0; thread_no < no_of_workers && no_of_cpus > 0; thread_no++) {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            CPU_SET(cpus[thread_no % no_of_cpus], &mask);
+            ok &= (pthread_setaffinity_np(threads[thread_no], sizeof(mask), &mask) == 0);
+        }
+        return ok;
+    }
+
+    //runs the job on the first no_of_threads workers and returns the time between the first
+    //worker starting the job and the last worker finishing it
+    double run(pool_job_p function, int no_of_threads) {
+        job = function;
+        for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
+            sem_post(&start_sem[thread_no]);
+        for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
+            while(sem_wait(&done_sem));
+
+        double first_begin = DBL_MAX, last_end = -DBL_MAX;
+        for(int thread_no = 0; thread_no < no_of_threads; thread_no++) {
+            if(job_begin[thread_no] < first_begin) first_begin = job_begin[thread_no];
+            if(job_end[thread_no] > last_end) last_end = job_end[thread_no];
+        }
+
+        return last_end - first_begin;
+    }
+
+    void stop() {
+        stop_flag = true;
+        for(int thread_no = 0; thread_no < no_of_workers; thread_no++)
+            sem_post(&start_sem[thread_no]);
+        for(int thread_no = 0; thread_no < no_of_workers; thread_no++) {
+            pthread_join(threads[thread_no], NULL);
+            sem_destroy(&start_sem[thread_no]);
+        }
+        sem_destroy(&done_sem);
+
+        delete[] threads;
+        delete[] args;
+        delete[] tid;
+        delete[] start_sem;
+        delete[] job_begin;
+        delete[] job_end;
+        no_of_workers = 0;
+        threads = NULL;
+        args = NULL;
+        tid = NULL;
+        start_sem = NULL;
+        job_begin = job_end = NULL;
+    }
+};
+
+#endif
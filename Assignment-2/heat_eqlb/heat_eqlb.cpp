@@ -2,47 +2,126 @@
 #include<pthread.h>
 #include<semaphore.h>
 #include<sys/time.h>
-#define MAX_REPEAT 5
-#define MAX_FUNCTIONS 3
-#define MAX_ARRAY_SIZE 20
+#include<getopt.h>
+#include "../common/fast_loader.h"
+#include "../common/thread_pool.h"
+#include "../common/perf_counters.h"
+#include "../common/bench_harness.h"
+#include "../common/results.h"
+#include "../common/futex_sync.h"
+#include "../common/lock_stats.h"
+#include "../common/cpu_topology.h"
+#include "../common/stencil_kernels.h"
+#define MAX_FUNCTIONS 6
 #define MAX_ITERATIONS 500
 #define COEFFICIENT (1e-2)
+#define DEFAULT_TILE_CELLS 4096
 using namespace std;
 
 typedef void* (*function_p) (void *);
 
-int array_size, no_of_threads, no_of_iterations, mutex_count;
-double *arr_old, *arr_new;
-double running_time_avg[MAX_FUNCTIONS];
-double running_time_max[MAX_FUNCTIONS];
-double running_time_min[MAX_FUNCTIONS];
+long long array_size;
+int no_of_threads, no_of_iterations, condition_cycle;
+atomic<int> mutex_count;
+//ping-pong buffers of cell_size byte cells: step t reads arr_buffer[(t - 1) & 1] and writes arr_buffer[t & 1], so
+//ending a step is just the flip of the parity at the barrier, every run starts from arr_initial (converted to the
+//precision) and must end in arr_reference, the serial steps with the scalar kernel
+double *arr_initial;
+void *arr_buffer[2], *arr_reference;
+stencil_precision precision = PRECISION_DOUBLE;
+size_t cell_size = sizeof(double);
+stencil_kernel_p stencil_kernel;
+simd_isa isa;
+//temporal blocking: the steps are advanced time_block at a time between two synchronisations, a group of steps
+//reads arr_buffer[(group - 1) & 1] and writes arr_buffer[group & 1], every thread goes through its block in tiles
+//of tile_cells cells with the intermediate steps in its two scratch buffers of tile_scratch_bytes
+int time_block = 1, no_of_groups;
+long long tile_cells = DEFAULT_TILE_CELLS;
+char *tile_scratch;
+size_t tile_scratch_bytes;
+//the thread counts of the sweep, every thread owns a contiguous block of cells
+vector<int> thread_counts;
+int max_threads;
+vector<vector<bench_stats>> running_time;
+vector<vector<perf_counts>> counters_avg;
+//process cpu seconds per run (average over the measured runs)
+vector<vector<double>> cpu_time;
+//runs whose final values are not bit-identical to the serial reference
+vector<vector<int>> mismatches;
+bool perf_enabled;
+perf_session perf;
+bench_config bench;
+results_config output;
 pthread_mutex_t sum_mutex;
 pthread_mutex_t condition_mutex;
 pthread_cond_t condition_var;
 pthread_barrier_t barrier_var;
+futex_mutex sum_futex_mutex;
+futex_barrier futex_barrier_var;
+neighbour_steps neighbour_steps_var;
 
 
+//the cells [my_low, my_high) of my_rank, the first array_size % no_of_threads blocks have one cell more
+static inline void rank_block(int my_rank, long long &my_low, long long &my_high) {
+    long long block = array_size / no_of_threads, extra = array_size % no_of_threads;
+    my_low = block * my_rank + min((long long) my_rank, extra);
+    my_high = my_low + block + (my_rank < extra);
+}
+
+//the rank whose block holds cell
+static inline int cell_rank(long long cell) {
+    long long block = array_size / no_of_threads, extra = array_size % no_of_threads;
+    if(cell < extra * (block + 1)) return cell / (block + 1);
+    return extra + (cell - extra * (block + 1)) / block;
+}
+
+//advances the cells [low, high) by the steps of group, a tile of the block is computed with a ghost zone that is
+//one cell narrower on either side after every step, so the last step only needs the tile itself: the first step
+//reads the old buffer, the intermediate ones go between the scratch buffers of my_rank (indexed by cell, like the
+//shared ones) and the last one writes the new buffer, every cell goes through the same kernel operations as in
+//the serial steps, so the values are bit-identical whatever the time block and tile width
+static inline void update_group(int my_rank, int group, long long low, long long high) {
+    const void *old = arr_buffer[(group - 1) & 1];
+    void *next = arr_buffer[group & 1];
+    int steps = min(time_block, no_of_iterations - (group - 1) * time_block);
+    if(steps == 1) {
+        stencil_kernel(old, next, low, high, array_size, COEFFICIENT);
+        return;
+    }
+
+    char *scratch_base = tile_scratch + 2 * my_rank * tile_scratch_bytes;
+    for(long long tile_low = low; tile_low < high; tile_low += tile_cells) {
+        long long tile_high = min(high, tile_low + tile_cells);
+        long long first_cell = max(0LL, tile_low - steps);
+        void *scratch[2] = {scratch_base - first_cell * cell_size, scratch_base + tile_scratch_bytes - first_cell * cell_size};
+        const void *from = old;
+        for(int step = 1; step <= steps; step++) {
+            long long ghost = steps - step;
+            void *to = (step == steps) ? next : scratch[step & 1];
+            stencil_kernel(from, to, max(0LL, tile_low - ghost), min(array_size, tile_high + ghost), array_size, COEFFICIENT);
+            from = to;
+        }
+    }
+}
+
+
+
+//the values of every group are read by the neighbouring blocks (up to time_block cells away) during the next one,
+//and are overwritten in the group after that, so one barrier per group is enough
 void* mutex_busy_wait_barrier(void *arg) {
     
     int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
     
-    for(int iter_count = 1; iter_count <= no_of_iterations; iter_count++) {
+    for(int group = 1; group <= no_of_groups; group++) {
 
-        if(my_rank - 1 >= 0) {
-            arr_new[my_rank] += (arr_old[my_rank - 1] - arr_old[my_rank]) * COEFFICIENT;
-        } 
-        if(my_rank + 1 < array_size) {
-            arr_new[my_rank] += (arr_old[my_rank + 1] - arr_old[my_rank]) * COEFFICIENT;
-        }
+        update_group(my_rank, group, my_low, my_high);
 
-        pthread_mutex_lock(&sum_mutex);
-        mutex_count++;
-        if(mutex_count == (no_of_threads * iter_count - 1)) {
-            for(int thrd = 0; thrd < no_of_threads; thrd++)
-                arr_old[thrd] = arr_new[thrd];
-        }
-        pthread_mutex_unlock(&sum_mutex);
-        while(mutex_count < no_of_threads * iter_count);
+        LOCK_STATS_ACQUIRE(my_rank, pthread_mutex_lock(&sum_mutex));
+        mutex_count.fetch_add(1, memory_order_relaxed);
+        LOCK_STATS_RELEASE(my_rank, pthread_mutex_unlock(&sum_mutex));
+        LOCK_STATS_WAIT(my_rank, while(mutex_count.load(memory_order_acquire) < no_of_threads * group) cpu_relax());
 
     }
 
@@ -50,30 +129,29 @@ void* mutex_busy_wait_barrier(void *arg) {
 }
 
 
+//the last thread to arrive starts the next cycle, the others wait for the cycle to change (so that a spurious
+//wakeup does not let them through)
 void* condition_var_barrier(void *arg) {
 
-    int my_rank = *((int*) arg), my_sum = 0;
+    int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
     
-    for(int iter_count = 1; iter_count <= no_of_iterations; iter_count++) {
+    for(int group = 1; group <= no_of_groups; group++) {
 
-        if(my_rank - 1 >= 0) {
-            arr_new[my_rank] += (arr_old[my_rank - 1] - arr_old[my_rank]) * COEFFICIENT;
-        } 
-        if(my_rank + 1 < array_size) {
-            arr_new[my_rank] += (arr_old[my_rank + 1] - arr_old[my_rank]) * COEFFICIENT;
-        }
+        update_group(my_rank, group, my_low, my_high);
 
-        pthread_mutex_lock(&condition_mutex);
+        LOCK_STATS_ACQUIRE(my_rank, pthread_mutex_lock(&condition_mutex));
+        int my_cycle = condition_cycle;
         mutex_count++;
         if(mutex_count == no_of_threads) {
             mutex_count = 0;
-            for(int thrd = 0; thrd < no_of_threads; thrd++)
-                arr_old[thrd] = arr_new[thrd];
+            condition_cycle++;
             pthread_cond_broadcast(&condition_var);
         } else {
-            while(pthread_cond_wait(&condition_var, &condition_mutex));
+            LOCK_STATS_WAIT(my_rank, while(condition_cycle == my_cycle) pthread_cond_wait(&condition_var, &condition_mutex));
         }
-        pthread_mutex_unlock(&condition_mutex);
+        LOCK_STATS_RELEASE(my_rank, pthread_mutex_unlock(&condition_mutex));
 
     }
 
@@ -83,32 +161,216 @@ void* condition_var_barrier(void *arg) {
 
 void* barrier_barrier(void *arg) {
 
-    int my_rank = *((int*) arg), my_sum = 0;
+    int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
 
-    for(int iter_count = 1; iter_count <= no_of_iterations; iter_count++) {
+    for(int group = 1; group <= no_of_groups; group++) {
 
-        if(my_rank - 1 >= 0) {
-            arr_new[my_rank] += (arr_old[my_rank - 1] - arr_old[my_rank]) * COEFFICIENT;
-        } 
-        if(my_rank + 1 < array_size) {
-            arr_new[my_rank] += (arr_old[my_rank + 1] - arr_old[my_rank]) * COEFFICIENT;
-        }
+        update_group(my_rank, group, my_low, my_high);
+
+        LOCK_STATS_WAIT(my_rank, pthread_barrier_wait(&barrier_var));
+    }
+
+    return NULL;
+}
+
+
+//mutex_busy_wait_barrier with the counter behind the spin-then-park futex mutex
+void* futex_mutex_busy_wait_barrier(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
+
+    for(int group = 1; group <= no_of_groups; group++) {
+
+        update_group(my_rank, group, my_low, my_high);
+
+        LOCK_STATS_ACQUIRE(my_rank, sum_futex_mutex.lock());
+        mutex_count.fetch_add(1, memory_order_relaxed);
+        LOCK_STATS_RELEASE(my_rank, sum_futex_mutex.unlock());
+        LOCK_STATS_WAIT(my_rank, while(mutex_count.load(memory_order_acquire) < no_of_threads * group) cpu_relax());
+
+    }
+
+    return NULL;
+}
+
+
+void* futex_barrier_barrier(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
+
+    for(int group = 1; group <= no_of_groups; group++) {
+
+        update_group(my_rank, group, my_low, my_high);
+
+        LOCK_STATS_WAIT(my_rank, futex_barrier_var.wait(my_rank));
+    }
+
+    return NULL;
+}
+
+//instead of a barrier every block waits only for the blocks its ghost zone reaches into (the two neighbours
+//unless the blocks are narrower than the time block): once they published group - 1, the cells this group reads
+//are complete and they no longer read the buffer it writes, so the blocks drift apart by at most one group
+void* neighbour_step_counters(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long my_low, my_high;
+    rank_block(my_rank, my_low, my_high);
+    int first_rank = cell_rank(max(0LL, my_low - time_block)), last_rank = cell_rank(min(array_size, my_high + time_block) - 1);
+
+    for(int group = 1; group <= no_of_groups; group++) {
 
-        pthread_barrier_wait(&barrier_var);
+        for(int rank = first_rank; rank <= last_rank; rank++)
+            if(rank != my_rank) LOCK_STATS_WAIT(my_rank, neighbour_steps_var.wait_for(rank, group - 1));
+
+        update_group(my_rank, group, my_low, my_high);
+
+        neighbour_steps_var.publish(my_rank, group);
     }
 
     return NULL;
 }
 
+//the cells of arr_initial in the precision of the run
+void load_initial(void *buffer) {
+    for(long long cell = 0; cell < array_size; cell++) {
+        if(precision == PRECISION_FLOAT) ((float *) buffer)[cell] = arr_initial[cell];
+        else ((double *) buffer)[cell] = arr_initial[cell];
+    }
+}
+
+double cell_value(const void *buffer, long long cell) {
+    return (precision == PRECISION_FLOAT) ? ((const float *) buffer)[cell] : ((const double *) buffer)[cell];
+}
+
+//the serial time stepping every strategy is compared with
+void reference_steps() {
+    stencil_kernel_p reference_kernel = select_stencil_kernel(precision, ISA_SCALAR);
+    void *scratch = malloc(array_size * cell_size);
+    void *current = arr_reference, *next = scratch;
+    load_initial(current);
+    for(int iter_count = 1; iter_count <= no_of_iterations; iter_count++) {
+        reference_kernel(current, next, 0, array_size, array_size, COEFFICIENT);
+        swap(current, next);
+    }
+    if(current != arr_reference) memcpy(arr_reference, current, array_size * cell_size);
+    free(scratch);
+}
+
+void free_arrays() {
+    delete[] arr_initial;
+    free(arr_reference);
+    free(arr_buffer[0]);
+    free(arr_buffer[1]);
+    free(tile_scratch);
+}
+
+void usage(const char *program_name) {
+    cerr << "Usage: " << program_name << " [options] [input_file]\n"
+         << "\t-p, --perf\t\tcapture hardware and software performance counters of the worker threads\n"
+         << "\t-t, --threads LIST\tthread counts to sweep: pow2 (default), all or a comma separated list, Nx is N times\n"
+         << "\t\t\t\tthe available cpus, at most " << MAX_OVERSUBSCRIPTION << "x, every thread updates a block of cells\n"
+         << "\t-y, --spin N\t\tspin rounds of the futex mutex, barrier and step counters before they sleep, auto (default)\n"
+         << "\t\t\t\tadapts them\n"
+         << "\t-s, --simd ISA\t\tstencil kernel: scalar, sse2, avx2 or avx512, defaults to the widest the cpu supports\n"
+         << "\t-e, --precision TYPE\tcells are double (default) or float\n"
+         << "\t-k, --time-block K\tsteps advanced between two synchronisations (default 1), every thread recomputes a\n"
+         << "\t\t\t\tghost zone of K cells on either side of its block instead of waiting after every step\n"
+         << "\t-w, --tile CELLS\twidth of the tiles a block is advanced through with -k (default " << DEFAULT_TILE_CELLS << ")\n"
+         << BENCH_USAGE
+         << RESULTS_USAGE
+         << "Without an input file the array is read from the console.\n";
+}
 
 int main(int argc, char **argv) {
 
+    static struct option long_options[] = {
+        {"perf", no_argument, NULL, 'p'},
+        {"threads", required_argument, NULL, 't'},
+        {"spin", required_argument, NULL, 'y'},
+        {"simd", required_argument, NULL, 's'},
+        {"precision", required_argument, NULL, 'e'},
+        {"time-block", required_argument, NULL, 'k'},
+        {"tile", required_argument, NULL, 'w'},
+        BENCH_LONG_OPTIONS,
+        RESULTS_LONG_OPTIONS,
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int option, futex_spin = FUTEX_SPIN_ADAPTIVE;
+    char *end;
+    const char *threads_arg = "pow2";
+    cpu_topology topology;
+    topology.detect();
+    simd_isa widest_isa = detect_simd_isa();
+    isa = widest_isa;
+    while((option = getopt_long(argc, argv, "t:y:s:e:k:w:ph", long_options, NULL)) != -1) {
+        switch(option) {
+            case 'p': perf_enabled = true; break;
+            case 't': threads_arg = optarg; break;
+            case 'y':
+                if(!parse_spin_limit(optarg, futex_spin)) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+                break;
+            case 's':
+                if(!parse_enum_name(optarg, simd_isa_names, NO_OF_ISAS, isa)) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+                if(isa > widest_isa) {
+                    cerr << "This cpu does not support " << simd_isa_names[isa] << ", the widest kernel it runs is "
+                         << simd_isa_names[widest_isa] << ".\nTerminating program........\n";
+                    exit(0);
+                }
+                break;
+            case 'e':
+                if(!parse_enum_name(optarg, stencil_precision_names, 2, precision)) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+                break;
+            case 'k':
+                time_block = strtol(optarg, &end, 10);
+                if(*end != '\0' || time_block < 1 || time_block > MAX_ITERATIONS) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+                break;
+            case 'w':
+                tile_cells = strtoll(optarg, &end, 10);
+                if(*end != '\0' || tile_cells < 1) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+                break;
+            default:
+                if(!bench_parse_option(option, optarg, bench) && !results_parse_option(option, optarg, output)) {
+                    usage(argv[0]);
+                    exit(0);
+                }
+        }
+    }
+    if(!parse_thread_counts(threads_arg, topology.available_cpus(), thread_counts)) {
+        usage(argv[0]);
+        exit(0);
+    }
+    max_threads = *max_element(thread_counts.begin(), thread_counts.end());
+    const char *input_file = (optind < argc) ? argv[optind] : NULL;
+
 
-    if(argc == 1) {
+    if(input_file == NULL) {
 
-        cout << "Enter the size of the array (should be between 2 and " << MAX_ARRAY_SIZE << " inclusive): ";
+        cout << "Enter the size of the array (should be at least " << max(2, max_threads) << "): ";
         cin >> array_size;
-        if(array_size < 2 || array_size > MAX_ARRAY_SIZE) {
+        if(array_size < max(2, max_threads)) {
             cerr << "Invalid array size entered.\nTerminating program.......\n";
             exit(0);
         }
@@ -120,39 +382,36 @@ int main(int argc, char **argv) {
             exit(0);
         }
 
-        arr_old = new double[array_size];
-        arr_new = new double[array_size];
+        arr_initial = new double[array_size];
         cout << "Enter the values of the array: \n";
-        for(int i = 0; i < array_size; i++) {
+        for(long long i = 0; i < array_size; i++) {
             cout << "\tIndex" << setw(9) << (i + 1) << " :\t";
-            cin >> arr_old[i]; 
-            arr_new[i] = arr_old[i];
+            cin >> arr_initial[i]; 
         }
 
     } else {
         
-        ifstream fin(argv[1]);
-        if(fin.is_open()) {
+        fast_loader fin;
+        if(fin.open(input_file)) {
 
-            fin >> array_size;
-            if(array_size < 2 || array_size > MAX_ARRAY_SIZE) {
+            if(!fin.read(array_size) || array_size < max(2, max_threads)) {
                 cerr << "Invalid array size entered.\nTerminating program.......\n";
                 exit(0);
             }
             
-            fin >> no_of_iterations;
-            if(no_of_iterations < 1 || no_of_iterations > MAX_ITERATIONS) {
+            if(!fin.read(no_of_iterations) || no_of_iterations < 1 || no_of_iterations > MAX_ITERATIONS) {
                 cerr << "Invalid input for number of iterations.\nTerminating program.......\n";
                 exit(0);
             }
 
-            arr_old = new double[array_size];
-            arr_new = new double[array_size];
-            for(int i = 0; i < array_size; i++) {
-                fin >> arr_old[i]; 
-                arr_new[i] = arr_old[i];
+            arr_initial = new double[array_size];
+            if(!fin.read_array(arr_initial, array_size)) {
+                cerr << "Invalid array values in input file.\nTerminating program.......\n";
+                exit(0);
             }
 
+            cout << "Loaded " << input_file << " (" << fixed << setprecision(2) << fin.size / (double) (1 << 20) << " MB) in "
+                 << setprecision(5) << fin.load_time << " seconds (" << setprecision(2) << fin.throughput() << " MB/s)\n";
             fin.close();
         } else {
             cerr << "Error opening input file.\nTerminating program........\n";
@@ -162,100 +421,179 @@ int main(int argc, char **argv) {
     }
 
 
-    function_p thread_functions[MAX_FUNCTIONS] = {&mutex_busy_wait_barrier, &condition_var_barrier, &barrier_barrier};
-    string thread_functions_name[] = {"MutexBusyWaitBarrier", "ConditionVariableBarrier", "BarrierBarrier"};
-    no_of_threads = array_size;
+    cell_size = (precision == PRECISION_FLOAT) ? sizeof(float) : sizeof(double);
+    stencil_kernel = select_stencil_kernel(precision, isa);
+    arr_buffer[0] = malloc(array_size * cell_size);
+    arr_buffer[1] = malloc(array_size * cell_size);
+    arr_reference = malloc(array_size * cell_size);
+    tile_cells = min(tile_cells, array_size);
+    tile_scratch_bytes = ((tile_cells + 2 * time_block) * cell_size + 63) / 64 * 64;
+    tile_scratch = (char *) aligned_alloc(64, 2 * max_threads * tile_scratch_bytes);
+    no_of_groups = (no_of_iterations + time_block - 1) / time_block;
+    if(arr_buffer[0] == NULL || arr_buffer[1] == NULL || arr_reference == NULL || tile_scratch == NULL) {
+        cerr << "Could not allocate the rod.\nTerminating program........\n";
+        free_arrays();
+        exit(0);
+    }
+    reference_steps();
+
+    function_p thread_functions[MAX_FUNCTIONS] = {&mutex_busy_wait_barrier, &condition_var_barrier, &barrier_barrier,
+                                                  &futex_mutex_busy_wait_barrier, &futex_barrier_barrier, &neighbour_step_counters};
+    string thread_functions_name[] = {"MutexBusyWaitBarrier", "ConditionVariableBarrier", "BarrierBarrier",
+                                      "FutexMutexBusyWaitBarrier", "FutexBarrier", "NeighbourStepCounters"};
 
     pthread_mutex_init(&sum_mutex, NULL);
     pthread_mutex_init(&condition_mutex, NULL);
     pthread_cond_init(&condition_var, NULL);
-    pthread_barrier_init(&barrier_var, NULL, no_of_threads);
+    pthread_barrier_init(&barrier_var, NULL, 1);
+    sum_futex_mutex.spin.limit = futex_barrier_var.spin.limit = neighbour_steps_var.spin.limit = futex_spin;
+
+    //the workers are created once, so that thread creation stays out of the timed runs
+    thread_pool pool;
+    if(!pool.start(max_threads)) {
+        cerr << "Error occurred during execution.\nTerminating program........\n";
+        free_arrays();
+        pthread_mutex_destroy(&sum_mutex);
+        pthread_mutex_destroy(&condition_mutex);
+        pthread_cond_destroy(&condition_var);
+        pthread_barrier_destroy(&barrier_var);
+        exit(0);
+    }
+    if(perf_enabled && !perf.open(pool.tid, max_threads)) {
+        cerr << "Could not open the performance counters (check /proc/sys/kernel/perf_event_paranoid), continuing without them\n";
+        perf_enabled = false;
+    }
 
+    string experiment = "iterations=" + to_string(no_of_iterations) + " precision=" + stencil_precision_names[precision]
+                        + " simd=" + simd_isa_names[isa];
+    if(time_block > 1) experiment += " time_block=" + to_string(time_block) + " tile=" + to_string(tile_cells);
+    LOCK_STATS_SECTION(experiment);
+    running_time.assign(MAX_FUNCTIONS, vector<bench_stats>(thread_counts.size()));
+    counters_avg.assign(MAX_FUNCTIONS, vector<perf_counts>(thread_counts.size()));
+    cpu_time.assign(MAX_FUNCTIONS, vector<double>(thread_counts.size()));
+    mismatches.assign(MAX_FUNCTIONS, vector<int>(thread_counts.size()));
     for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
 
-    running_time_avg[function_no] = 0;
-    running_time_max[function_no] = -DBL_MAX;
-    running_time_min[function_no] = DBL_MAX;
-
-        for(int repeat_count = 0; repeat_count < MAX_REPEAT; repeat_count++) {
-            struct timeval start_time, end_time; 
-            gettimeofday(&start_time, NULL);
-
-            pthread_t threads[no_of_threads];
-            int thread_arg[no_of_threads];
-            mutex_count = 0;
-
-            for(int thread_no = 0; thread_no < no_of_threads; thread_no++) {
-                thread_arg[thread_no] = thread_no;
-                int ret = pthread_create(&threads[thread_no], NULL, thread_functions[function_no], (void *) (&thread_arg[thread_no]));
-                if(ret != 0) {
-                    cerr << "Error occurred during execution.\nTerminating program........\n";
-                    for(int thread__no = 0; thread__no < thread_no; thread__no++)
-                        pthread_cancel(threads[thread__no]);
-                        
-                    delete[] arr_old;
-                    delete[] arr_new;
-                    pthread_mutex_destroy(&sum_mutex);
-                    pthread_mutex_destroy(&condition_mutex);
-                    pthread_cond_destroy(&condition_var);
-                    pthread_barrier_destroy(&barrier_var);
-                    exit(0);
-                }
-            }
-
-            for(int thread_no = 0; thread_no < no_of_threads; thread_no++)
-                pthread_join(threads[thread_no], NULL);
-
-            gettimeofday(&end_time, NULL);
-            double time_taken;
-            time_taken = (end_time.tv_sec - start_time.tv_sec) * 1e6; 
-            time_taken = (time_taken + (end_time.tv_usec - start_time.tv_usec)) * 1e-6;
-            running_time_avg[function_no] += time_taken;
-            if(time_taken > running_time_max[function_no])
-                running_time_max[function_no] = time_taken;
-            if(time_taken < running_time_min[function_no])
-                running_time_min[function_no] = time_taken;
+        for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+
+            no_of_threads = thread_counts[count_no];
+            pthread_barrier_destroy(&barrier_var);
+            pthread_barrier_init(&barrier_var, NULL, no_of_threads);
+            perf_counts &counters = counters_avg[function_no][count_no];
+            perf_clear(counters);
+
+            running_time[function_no][count_no] = bench_measure(bench, [&](bool warmup) {
+                mutex_count = condition_cycle = 0;
+                futex_barrier_var.reset(no_of_threads);
+                neighbour_steps_var.reset(no_of_threads);
+                load_initial(arr_buffer[0]);
+
+                if(perf_enabled && !warmup) perf.start(no_of_threads);
+                LOCK_STATS_BEGIN_RUN(no_of_threads);
+                double cpu_start = process_cpu_time();
+                double time_taken = pool.run(thread_functions[function_no], no_of_threads);
+                if(!warmup) cpu_time[function_no][count_no] += process_cpu_time() - cpu_start;
+                LOCK_STATS_END_RUN(thread_functions_name[function_no], no_of_threads, warmup);
+                if(perf_enabled && !warmup) perf_accumulate(counters, perf.stop(no_of_threads), 1);
+                mismatches[function_no][count_no] += (memcmp(arr_buffer[no_of_groups & 1], arr_reference, array_size * cell_size) != 0);
+                return time_taken;
+            });
+
+            perf_scale(counters, 1.0 / running_time[function_no][count_no].samples.size());
+            cpu_time[function_no][count_no] /= running_time[function_no][count_no].samples.size();
         }
-
-        running_time_avg[function_no] /= MAX_REPEAT;
-
     }
 
-    if(argc != 1) cout << "For " << argv[1] << "\n";
+    if(input_file != NULL) cout << "For " << input_file << "\n";
     cout << "The size of the array is: " << array_size << "\n";
-    cout << "The number of iterations is: " << no_of_iterations << "\n\n";
+    cout << "The number of iterations is: " << no_of_iterations << "\n";
+    cout << "Stencil kernel: " << simd_isa_names[isa] << " on " << stencil_precision_names[precision]
+         << " cells (widest supported: " << simd_isa_names[widest_isa] << ")\n";
+    cout << "Steps per synchronisation: " << time_block << " (" << no_of_groups << " synchronisations per run";
+    if(time_block > 1) cout << ", tiles of " << tile_cells << " cells";
+    cout << ")\n";
+    double total_heat = 0;
+    for(long long cell = 0; cell < array_size; cell++) total_heat += cell_value(arr_reference, cell);
+    cout << "The average value after the last iteration is: " << setprecision(5) << fixed << total_heat / array_size << "\n";
+    cout << "Warmup runs: " << bench.warmup_runs << ", measured runs: " << bench.min_repeat << " to " << bench.max_repeat
+         << " until the 95% confidence interval is within " << fixed << setprecision(1) << bench.target_ci * 100 << "% of the average\n";
+    cout << "Futex spin before sleeping: ";
+    if(futex_spin == FUTEX_SPIN_ADAPTIVE) cout << "adaptive (mutex estimate " << sum_futex_mutex.spin.estimate << " rounds, barrier "
+                                               << futex_barrier_var.spin.estimate << " rounds, step counters "
+                                               << neighbour_steps_var.spin.estimate << " rounds at the end)\n\n";
+    else cout << futex_spin << " rounds\n\n";
     
-    cout << "The time spent for reaching equilibrium is (avg, max, min):\n";
+    //every step reads the old value of a cell and writes the new one, the neighbours come from the cache (with -k
+    //the intermediate steps stay in the tiles, so this is the effective bandwidth of the per-step version)
+    double cells_per_run = (double) array_size * no_of_iterations;
+    double bytes_per_run = cells_per_run * 2 * cell_size;
+    cout << "The time spent for reaching equilibrium is (avg, max, min, median, p90, p99, stddev, 95% CI, runs (outliers)):\n";
     for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
-        cout << thread_functions_name[function_no] << " : " << fixed << setprecision(5) 
-             << running_time_avg[function_no] << " " << running_time_max[function_no] << " " << running_time_min[function_no] << "\n";
-    }
-    
-
-    ofstream fout("data.txt");
-    if(fout.is_open()) {
-
-        if(argc == 1) fout << "Console input\n";
-        else fout << argv[1] << "\n";
-        fout << array_size << "\n" << no_of_iterations << "\n";
-        fout << MAX_FUNCTIONS << "\n";
-        for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++) {
-            fout << thread_functions_name[function_no] << "\n";
-            fout << setw(10) << setprecision(5) << running_time_avg[function_no] << "\n";
-            fout << running_time_max[function_no] << "\n" << running_time_min[function_no] << "\n";
+        cout << thread_functions_name[function_no] << " :\n";
+        for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+            bench_stats &stats = running_time[function_no][count_no];
+            cout << "\t" << setw(4) << thread_counts[count_no] << " threads : " << fixed << setprecision(5)
+                 << stats.mean << " " << stats.max << " " << stats.min << " " << stats.median << " " << stats.p90 << " "
+                 << stats.p99 << " " << stats.stddev << " +/-" << stats.ci_half_width << " " << stats.samples.size()
+                 << " (" << stats.no_of_outliers << ")" << (stats.converged ? "" : " not converged");
+            if(mismatches[function_no][count_no] > 0) cout << ", " << mismatches[function_no][count_no] << " runs DIFFER from the serial steps";
+            cout << "\n";
+            cout << "\t\tcpu time " << cpu_time[function_no][count_no] << " per run (" << setprecision(2)
+                 << cpu_time[function_no][count_no] / stats.mean << "x the average time)\n";
+            cout << "\t\t" << setprecision(2) << cells_per_run / stats.mean / 1e6 << " Mcells/s, "
+                 << bytes_per_run / stats.mean / 1e9 << " GB/s\n";
+            if(perf_enabled) {
+                cout << "\t\t";
+                for(int event_no = 0; event_no < PERF_NO_OF_EVENTS; event_no++)
+                    cout << perf_event_names[event_no] << " " << setprecision(0) << counters_avg[function_no][count_no].value[event_no] << "  ";
+                cout << "(average per run)\n";
+            }
         }
-        fout.close();
-    } else {
-        cerr << "Error writing output to file\n.Terminating program........";
+    }
+    cout << "\n";
+    //the slack the neighbour-only synchronisation recovers, against the fastest of the global barriers
+    cout << "NeighbourStepCounters against the fastest global barrier (median times):\n";
+    for(size_t count_no = 0; count_no < thread_counts.size(); count_no++) {
+        int fastest = 0;
+        for(int function_no = 1; function_no < MAX_FUNCTIONS - 1; function_no++)
+            if(running_time[function_no][count_no].median < running_time[fastest][count_no].median) fastest = function_no;
+        double neighbour_median = running_time[MAX_FUNCTIONS - 1][count_no].median;
+        cout << "\t" << setw(4) << thread_counts[count_no] << " threads : " << setprecision(5) << neighbour_median << " against "
+             << running_time[fastest][count_no].median << " (" << thread_functions_name[fastest] << "), " << setprecision(2)
+             << running_time[fastest][count_no].median / neighbour_median << "x\n";
+    }
+    cout << "\n";
+    LOCK_STATS_PRINT_SUMMARY();
+
+
+    result_set results;
+    results.program = "heat_eqlb";
+    results.input = (input_file == NULL) ? "console" : input_file;
+    results.problem_size = array_size;
+    results.host.collect();
+    for(int function_no = 0; function_no < MAX_FUNCTIONS; function_no++)
+        for(size_t count_no = 0; count_no < thread_counts.size(); count_no++)
+            results.add(experiment, thread_functions_name[function_no], thread_counts[count_no],
+                        running_time[function_no][count_no], perf_enabled ? &counters_avg[function_no][count_no] : NULL,
+                        bytes_per_run);
+    results.compute_speedup();
+
+    if(!results.write(output.output))
+        cerr << "Error writing the results to " << output.output << "\n";
+    int no_of_regressions = 0;
+    if(!output.baseline.empty()) {
+        no_of_regressions = compare_with_baseline(results, output.baseline, output.threshold);
+        if(no_of_regressions < 0) cerr << "Could not read the baseline " << output.baseline << "\n";
     }
 
 
-    delete[] arr_old;
-    delete[] arr_new;
+    if(perf_enabled) perf.close();
+    pool.stop();
+    free_arrays();
     pthread_mutex_destroy(&sum_mutex);
     pthread_mutex_destroy(&condition_mutex);
     pthread_cond_destroy(&condition_var);
     pthread_barrier_destroy(&barrier_var);
 
-    return 0;
+    return (no_of_regressions > 0) ? 1 : 0;
 }
\ No newline at end of file
@@ -1,24 +1,77 @@
 #include<bits/stdc++.h>
-#define MAX_INPUT_FILES 10
+#include<unistd.h>
+//the limit heat_eqlb accepts
+#define MAX_ITERATIONS 500
 using namespace std;
 
 const double PI = acos(-1);
 
-int main() {
+bool write_input_file(const string &input_file_name, long long arr_sz, int iter) {
+    ofstream fout(input_file_name);
+    fout << arr_sz << "\n";
+    fout << iter << "\n";
+    for(long long i = 0; i < arr_sz; i++)
+        fout << fixed << setprecision(5) << (rand() % 1000) * sin((rand() % 1000) * PI / 1000) << "\n";
+    return (bool) fout;
+}
 
-    int array_size[] = {2, 4, 6}, no_of_iterations[] = {50, 100, 200};
-    int input_file_no = 1;
+void usage(const char *program_name) {
+    cerr << "Usage: " << program_name << " [-n cells -i iterations [-o file]]\n"
+         << "\tcells at least 2, iterations between 1 and " << MAX_ITERATIONS << ".\n"
+         << "\tWithout -n the files input1.txt to input9.txt are written, with -n a single file (default input.txt).\n";
+}
+
+int main(int argc, char **argv) {
+
+    long long no_of_cells = 0;
+    int no_of_iterations = 100;
+    string output_file = "input.txt";
     srand(time(0));
-    
-    for(auto arr_sz : array_size)
-        for(auto iter : no_of_iterations) {
-            const char * input_file_name = ("input" + to_string(input_file_no++) + ".txt").c_str();
-            freopen(input_file_name, "w", stdout);
-            cout << arr_sz << "\n";
-            cout << iter << "\n";
-            for(int i = 0; i < arr_sz; i++)
-                cout << fixed << setprecision(5) << (rand() % 1000) * sin((rand() % 1000) * PI / 1000) << "\n";
+
+    int option;
+    char *end;
+    while((option = getopt(argc, argv, "n:i:o:h")) != -1) {
+        switch(option) {
+            case 'n':
+                no_of_cells = strtoll(optarg, &end, 10);
+                if(*end != '\0' || no_of_cells < 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'i':
+                no_of_iterations = strtol(optarg, &end, 10);
+                if(*end != '\0' || no_of_iterations < 1 || no_of_iterations > MAX_ITERATIONS) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o': output_file = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(no_of_cells > 0) {
+        if(!write_input_file(output_file, no_of_cells, no_of_iterations)) {
+            cerr << "Error writing " << output_file << ".\nTerminating program........\n";
+            return 1;
         }
-    
+        return 0;
+    }
+
+    //blocks of a few hundred cells up to a few hundred thousand per thread
+    long long array_size[] = {1000, 100000, 1000000};
+    int no_of_iterations_list[] = {50, 100, 200};
+    int input_file_no = 1;
+
+    for(auto arr_sz : array_size)
+        for(auto iter : no_of_iterations_list)
+            if(!write_input_file("input" + to_string(input_file_no++) + ".txt", arr_sz, iter)) {
+                cerr << "Error writing the input files.\nTerminating program........\n";
+                return 1;
+            }
+
     return 0;
-}
\ No newline at end of file
+}
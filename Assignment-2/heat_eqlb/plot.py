@@ -1,41 +1,42 @@
-import matplotlib.pyplot as plt
+import csv
+import sys
+from collections import OrderedDict
 
-input_file_name = input().split(".")[0]
-array_size = int(input())
-no_of_iterations = int(input())
-MAX_FUNCTIONS = int(input())
+import matplotlib.pyplot as plt
 
-colors = ['b', 'g', 'r', 'c', 'm', 'y', 'k']
-function_names = []
-avg_running_time = []
-max_running_time = []
-min_running_time = []
+results_file_name = sys.argv[1] if len(sys.argv) > 1 else "results.csv"
+with open(results_file_name) as results_file:
+    records = list(csv.DictReader(results_file))
 
-for function_no in range(MAX_FUNCTIONS):
-    function_names.append(input())
-    avg_running_time.append(float(input()))
-    max_running_time.append(float(input()))
-    min_running_time.append(float(input()))
+input_file_name = records[0]["input"].split("/")[-1].split(".")[0]
+array_size = records[0]["problem_size"]
+experiment = records[0]["experiment"]
 
-plt.figure()    
-plt.bar(range(1, MAX_FUNCTIONS + 1), avg_running_time)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ", no of iterations = " + str(no_of_iterations) + ")" )
-plt.xticks(range(1, MAX_FUNCTIONS + 1), function_names)
-plt.ylabel("Average Running time (seconds)")
-plt.savefig(input_file_name + "_avg.png")
+# times[strategy][threads] = the times of all repeats, in the order they were run
+times = OrderedDict()
+for record in records:
+    times.setdefault(record["strategy"], OrderedDict()).setdefault(int(record["threads"]), []).append(float(record["time"]))
 
-plt.figure()    
-plt.bar(range(1, MAX_FUNCTIONS + 1), max_running_time)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ", no of iterations = " + str(no_of_iterations) + ")" )
-plt.xticks(range(1, MAX_FUNCTIONS + 1), function_names)
-plt.ylabel("Maximum Running time (seconds)")
-plt.savefig(input_file_name + "_max.png")
+function_names = list(times.keys())
+MAX_FUNCTIONS = len(function_names)
+thread_counts = sorted({threads for samples in times.values() for threads in samples})
+kinds = [("Average", "avg", lambda samples: sum(samples) / len(samples)), ("Maximum", "max", max), ("Minimum", "min", min)]
 
-plt.figure()    
-plt.bar(range(1, MAX_FUNCTIONS + 1), avg_running_time)
-plt.title(input_file_name + "  (array size = " + str(array_size) + ", no of iterations = " + str(no_of_iterations) + ")" )
-plt.xticks(range(1, MAX_FUNCTIONS + 1), function_names)
-plt.ylabel("Minimum Running time (seconds)")
-plt.savefig(input_file_name + "_min.png")
+for kind, short_kind, reduce in kinds:
+    plt.figure()
+    if len(thread_counts) == 1:
+        # one bar per strategy
+        plt.bar(range(1, MAX_FUNCTIONS + 1), [reduce(samples[thread_counts[0]]) for samples in times.values()])
+        plt.xticks(range(1, MAX_FUNCTIONS + 1), function_names)
+    else:
+        # one line per strategy over the thread counts
+        for function_name, samples in times.items():
+            threads = sorted(samples.keys())
+            plt.plot(threads, [reduce(samples[thread]) for thread in threads], marker="o", label=function_name)
+        plt.xlabel("No of threads")
+        plt.legend()
+    plt.title(input_file_name + "  (array size = " + array_size + ", " + experiment + ")")
+    plt.ylabel(kind + " Running time (seconds)")
+    plt.savefig(input_file_name + "_" + short_kind + ".png")
 
-plt.show()
\ No newline at end of file
+plt.show()
@@ -0,0 +1,326 @@
+#include<bits/stdc++.h>
+#include<pthread.h>
+#include<getopt.h>
+#include "../common/thread_pool.h"
+#include "../common/fast_loader.h"
+#include "../common/binary_array.h"
+#include "../common/bench_harness.h"
+#include "../common/results.h"
+#include "../common/cpu_topology.h"
+#include "../common/reduce_kernels.h"
+#include "../common/log_histogram.h"
+#include "../common/bounded_queues.h"
+#define PIPELINE_PASSES 10
+#define MAX_QUEUES 4
+#define DEFAULT_CHUNK 4096
+#define DEFAULT_CAPACITY 64
+#define CACHE_LINE_SIZE 64
+#define MAX_ARRAY_SIZE (int)(1e9)
+using namespace std;
+
+typedef void* (*function_p) (void *);
+
+//the producers deal the chunks of the array (PIPELINE_PASSES times over) into a bounded queue, the consumers
+//take them out and sum them with reduce_kernel, the first no_of_producers pool ranks are the producers
+long long array_size, chunk_size = DEFAULT_CHUNK, global_sum;
+int no_of_producers, no_of_consumers, capacity = DEFAULT_CAPACITY;
+const void *arr;
+uint32_t arr_type = ELEMENT_INT32;
+size_t arr_element_size = sizeof(int);
+reduce_kernel_p reduce_kernel;
+binary_array_file arr_file;
+atomic<int> producers_left;
+
+struct alignas(CACHE_LINE_SIZE) padded_sum {
+    long long value;
+};
+padded_sum *consumer_sum;
+//the enqueue to dequeue latency in nanoseconds seen by each consumer during one run
+log_histogram *consumer_latency;
+
+semaphore_queue sem_queue;
+condvar_queue cv_queue;
+vyukov_queue mpmc_queue;
+spsc_ring_set spsc_queue;
+
+//one (producers, consumers) point of the sweep
+struct pipeline_point {
+    int producers, consumers;
+    vector<bench_stats> running_time;
+    vector<log_histogram> latency;
+};
+vector<pipeline_point> points;
+
+bench_config bench;
+results_config output;
+cpu_topology topology;
+affinity_policy affinity = AFFINITY_NONE;
+
+
+template<class Queue, Queue *queue>
+void* pipeline_stage(void *arg) {
+
+    int my_rank = *((int*) arg);
+    long long chunks_per_pass = (array_size + chunk_size - 1) / chunk_size;
+
+    if(my_rank < no_of_producers) {
+        for(long long id = my_rank; id < PIPELINE_PASSES * chunks_per_pass; id += no_of_producers) {
+            long long low = (id % chunks_per_pass) * chunk_size;
+            queue->push(my_rank, queue_item{low, min(low + chunk_size, array_size), monotonic_ns()});
+        }
+
+        //every consumer stops at its first end marker, so they are sent after the items of all producers,
+        //with a channel per pair every producer closes its own channels
+        queue_item end_of_stream = {0, -1, 0};
+        if constexpr(Queue::per_pair) {
+            for(int consumer = 0; consumer < no_of_consumers; consumer++)
+                queue->push_to(my_rank, consumer, end_of_stream);
+        } else if(producers_left.fetch_sub(1) == 1) {
+            for(int consumer = 0; consumer < no_of_consumers; consumer++)
+                queue->push(my_rank, end_of_stream);
+        }
+    } else {
+        int my_consumer = my_rank - no_of_producers;
+        int ends_to_see = Queue::per_pair ? no_of_producers : 1;
+        log_histogram &my_latency = consumer_latency[my_consumer];
+        long long my_sum = 0;
+
+        while(true) {
+            queue_item item = queue->pop(my_consumer);
+            if(item.high < 0) {
+                if(--ends_to_see == 0) break;
+                continue;
+            }
+            my_latency.record(monotonic_ns() - item.enqueue_ns);
+            my_sum += reduce_kernel(arr, item.low, item.high);
+        }
+        consumer_sum[my_consumer].value = my_sum;
+    }
+
+    return NULL;
+}
+
+//parses a comma separated list of positive integers
+bool parse_list(const char *str, vector<int> &values) {
+    values.clear();
+    while(*str != '\0') {
+        char *end;
+        long value = strtol(str, &end, 10);
+        if(end == str || value < 1 || (*end != ',' && *end != '\0')) return false;
+        values.push_back(value);
+        str = (*end == ',') ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+void usage(const char *program_name) {
+    cerr << "Usage: " << program_name << " [options] input_file\n"
+         << "\t-P, --producers LIST\tnumbers of producer threads to sweep (default 1,2)\n"
+         << "\t-C, --consumers LIST\tnumbers of consumer threads to sweep (default 1,2)\n"
+         << "\t-q, --capacity N\titems the queue holds, per pair for the SPSC rings, at least 2 for the MPMC ring\n"
+         << "\t\t\t\t(default " << DEFAULT_CAPACITY << ")\n"
+         << "\t-c, --chunk N\t\telements per item (default " << DEFAULT_CHUNK << ")\n"
+         << "\t-a, --affinity POLICY\tpin the threads: none (default), compact, scatter or physical (one per core)\n"
+         << BENCH_USAGE
+         << RESULTS_USAGE
+         << "Every combination of the two lists is run, the input is a text or binary array as for array_sum.\n";
+}
+
+int main(int argc, char **argv) {
+
+    vector<int> producer_list = {1, 2}, consumer_list = {1, 2};
+    topology.detect();
+    static struct option long_options[] = {
+        {"producers", required_argument, NULL, 'P'},
+        {"consumers", required_argument, NULL, 'C'},
+        {"capacity", required_argument, NULL, 'q'},
+        {"chunk", required_argument, NULL, 'c'},
+        {"affinity", required_argument, NULL, 'a'},
+        BENCH_LONG_OPTIONS,
+        RESULTS_LONG_OPTIONS,
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int option;
+    while((option = getopt_long(argc, argv, "P:C:q:c:a:h", long_options, NULL)) != -1) {
+        bool ok = true;
+        char *end;
+        switch(option) {
+            case 'P': ok = parse_list(optarg, producer_list); break;
+            case 'C': ok = parse_list(optarg, consumer_list); break;
+            case 'q': capacity = strtol(optarg, &end, 10); ok = (*end == '\0' && capacity > 0); break;
+            case 'c': chunk_size = strtoll(optarg, &end, 10); ok = (*end == '\0' && chunk_size > 0); break;
+            case 'a': ok = parse_enum_name(optarg, affinity_policy_names, 4, affinity); break;
+            default: ok = bench_parse_option(option, optarg, bench) || results_parse_option(option, optarg, output);
+        }
+        if(!ok) {
+            usage(argv[0]);
+            exit(0);
+        }
+    }
+    int max_producers = *max_element(producer_list.begin(), producer_list.end());
+    int max_consumers = *max_element(consumer_list.begin(), consumer_list.end());
+    int max_threads = max_producers + max_consumers;
+    if(optind >= argc || max_threads > MAX_OVERSUBSCRIPTION * topology.available_cpus()) {
+        usage(argv[0]);
+        exit(0);
+    }
+    const char *input_file = argv[optind];
+
+
+    int status = arr_file.open(input_file);
+    fast_loader fin;
+    if(status == BINARY_ARRAY_OK) {
+        array_size = arr_file.header.count;
+        arr_type = arr_file.header.element_type;
+        arr_element_size = element_size(arr_type);
+        arr = arr_file.data;
+    } else if(status == BINARY_ARRAY_INVALID || status == BINARY_ARRAY_BAD_CHECKSUM) {
+        cerr << (status == BINARY_ARRAY_INVALID ? "Malformed binary input file.\n" : "Checksum mismatch in binary input file.\n")
+             << "Terminating program........\n";
+        exit(0);
+    } else if(fin.open(input_file)) {
+        if(!fin.read(array_size) || array_size < 1 || array_size > MAX_ARRAY_SIZE) {
+            cerr << "Invalid array size entered.\nTerminating program.......\n";
+            exit(0);
+        }
+        int *elements = new int[array_size];
+        arr = elements;
+        if(!fin.read_array(elements, array_size)) {
+            cerr << "Invalid array elements in input file.\nTerminating program.......\n";
+            exit(0);
+        }
+        fin.close();
+    } else {
+        cerr << "Error opening input file.\nTerminating program........\n";
+        exit(0);
+    }
+    if(array_size < 1 || array_size > MAX_ARRAY_SIZE) {
+        cerr << "Invalid array size entered.\nTerminating program.......\n";
+        exit(0);
+    }
+    reduce_kernel = select_reduce_kernel(arr_type, detect_simd_isa());
+
+
+    function_p queue_functions[MAX_QUEUES] = {&pipeline_stage<semaphore_queue, &sem_queue>, &pipeline_stage<condvar_queue, &cv_queue>,
+                                              &pipeline_stage<vyukov_queue, &mpmc_queue>, &pipeline_stage<spsc_ring_set, &spsc_queue>};
+    string queue_functions_name[] = {"Semaphores", "MutexCondvars", "VyukovMPMC", "SPSCRings"};
+
+    consumer_sum = new padded_sum[max_consumers];
+    consumer_latency = new log_histogram[max_consumers];
+    thread_pool pool;
+    if(!pool.start(max_threads)) {
+        cerr << "Error occurred during execution.\nTerminating program........\n";
+        exit(0);
+    }
+    vector<int> cpus = topology.cpu_order(affinity);
+    if(!pool.pin(cpus.data(), cpus.size()))
+        cerr << "Could not pin every thread to its cpu, continuing with the ones that could be pinned\n";
+
+    long long items_per_run = (array_size + chunk_size - 1) / chunk_size * PIPELINE_PASSES;
+    //chunk by chunk as the consumers do, floating point chunk sums are rounded one by one
+    long long expected_sum = 0;
+    for(long long low = 0; low < array_size; low += chunk_size)
+        expected_sum += reduce_kernel(arr, low, min(low + chunk_size, array_size));
+    expected_sum *= PIPELINE_PASSES;
+    int no_of_wrong_sums = 0;
+
+    for(int producers : producer_list) {
+        for(int consumers : consumer_list) {
+
+            points.push_back(pipeline_point());
+            pipeline_point &point = points.back();
+            point.producers = no_of_producers = producers;
+            point.consumers = no_of_consumers = consumers;
+            point.running_time.assign(MAX_QUEUES, bench_stats());
+            point.latency.assign(MAX_QUEUES, log_histogram());
+
+            for(int queue_no = 0; queue_no < MAX_QUEUES; queue_no++) {
+
+                point.running_time[queue_no] = bench_measure(bench, [&](bool warmup) {
+
+                    switch(queue_no) {
+                        case 0: sem_queue.reset(capacity, producers, consumers); break;
+                        case 1: cv_queue.reset(capacity, producers, consumers); break;
+                        case 2: mpmc_queue.reset(capacity, producers, consumers); break;
+                        default: spsc_queue.reset(capacity, producers, consumers);
+                    }
+                    producers_left = producers;
+                    for(int consumer = 0; consumer < consumers; consumer++) {
+                        consumer_sum[consumer].value = 0;
+                        consumer_latency[consumer].clear();
+                    }
+
+                    double time_taken = pool.run(queue_functions[queue_no], producers + consumers);
+
+                    global_sum = 0;
+                    for(int consumer = 0; consumer < consumers; consumer++) {
+                        global_sum += consumer_sum[consumer].value;
+                        if(!warmup) point.latency[queue_no].merge(consumer_latency[consumer]);
+                    }
+                    no_of_wrong_sums += (global_sum != expected_sum);
+                    return time_taken;
+                });
+            }
+        }
+    }
+
+    cout << "For " << input_file << "\n";
+    cout << "\nThe sum of the array is: " << global_sum / PIPELINE_PASSES << "\n";
+    if(no_of_wrong_sums > 0) cout << no_of_wrong_sums << " runs did NOT sum to " << expected_sum << "\n";
+    cout << "The size of the array is: " << array_size << " (" << element_type_name(arr_type) << " elements), "
+         << items_per_run << " items of " << chunk_size << " elements per run, queue capacity " << capacity << "\n";
+    cout << "Available cpus: " << topology.available_cpus() << ", affinity policy: " << affinity_policy_names[affinity] << "\n";
+    cout << "Warmup runs: " << bench.warmup_runs << ", measured runs: " << bench.min_repeat << " to " << bench.max_repeat
+         << " until the 95% confidence interval is within " << fixed << setprecision(1) << bench.target_ci * 100 << "% of the average\n\n";
+
+    for(auto &point : points) {
+        cout << "Producers: " << point.producers << ", consumers: " << point.consumers << "\n";
+        cout << setw(16) << left << "queue" << right << setw(14) << "items/s" << setw(12) << "time" << setw(12) << "+/-CI"
+             << "   latency in us:" << setw(10) << "mean" << setw(10) << "median" << setw(10) << "p90" << setw(10) << "p99"
+             << setw(10) << "p99.9" << setw(12) << "max" << setw(10) << "runs\n";
+        for(int queue_no = 0; queue_no < MAX_QUEUES; queue_no++) {
+            bench_stats &stats = point.running_time[queue_no];
+            log_histogram &latency = point.latency[queue_no];
+            cout << setw(16) << left << queue_functions_name[queue_no] << right << setw(14) << setprecision(0) << items_per_run / stats.mean
+                 << setw(12) << setprecision(5) << stats.mean << setw(12) << stats.ci_half_width << setw(16) << "" << setprecision(2)
+                 << setw(10) << latency.mean() / 1e3 << setw(10) << latency.percentile(50) / 1e3 << setw(10) << latency.percentile(90) / 1e3
+                 << setw(10) << latency.percentile(99) / 1e3 << setw(10) << latency.percentile(99.9) / 1e3 << setw(12) << latency.max / 1e3
+                 << setw(9) << (to_string(stats.samples.size()) + (stats.converged ? "" : "*")) << "\n";
+        }
+        cout << "\n";
+    }
+
+
+    result_set results;
+    results.program = "pipeline";
+    results.input = input_file;
+    results.problem_size = array_size;
+    results.host.collect();
+    double bytes_per_run = (double) array_size * arr_element_size * PIPELINE_PASSES;
+    for(auto &point : points) {
+        string experiment = "producers=" + to_string(point.producers) + " consumers=" + to_string(point.consumers)
+                            + " capacity=" + to_string(capacity) + " chunk=" + to_string(chunk_size)
+                            + " affinity=" + affinity_policy_names[affinity];
+        for(int queue_no = 0; queue_no < MAX_QUEUES; queue_no++)
+            results.add(experiment, queue_functions_name[queue_no], point.producers + point.consumers, point.running_time[queue_no],
+                        NULL, bytes_per_run);
+    }
+
+    if(!results.write(output.output))
+        cerr << "Error writing the results to " << output.output << "\n";
+    int no_of_regressions = 0;
+    if(!output.baseline.empty()) {
+        no_of_regressions = compare_with_baseline(results, output.baseline, output.threshold);
+        if(no_of_regressions < 0) cerr << "Could not read the baseline " << output.baseline << "\n";
+    }
+
+
+    pool.stop();
+    if(arr_file.data != NULL) arr_file.close();
+    else delete[] (const int *) arr;
+    delete[] consumer_sum;
+    delete[] consumer_latency;
+
+    return (no_of_regressions > 0 || no_of_wrong_sums > 0) ? 1 : 0;
+}
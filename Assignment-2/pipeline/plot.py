@@ -0,0 +1,36 @@
+import csv
+import sys
+from collections import OrderedDict
+
+import matplotlib.pyplot as plt
+
+results_file_name = sys.argv[1] if len(sys.argv) > 1 else "results.csv"
+with open(results_file_name) as results_file:
+    records = list(csv.DictReader(results_file))
+
+input_file_name = records[0]["input"].split("/")[-1].split(".")[0]
+array_size = records[0]["problem_size"]
+
+# the bandwidth of every repeat, grouped by (producers, consumers) and queue in the order they were run
+bandwidth = OrderedDict()
+for record in records:
+    fields = dict(field.split("=") for field in record["experiment"].split())
+    point = fields["producers"] + "P/" + fields["consumers"] + "C"
+    bandwidth.setdefault(point, OrderedDict()).setdefault(record["strategy"], []).append(float(record["gbytes_per_s"]))
+
+points = list(bandwidth.keys())
+queue_names = list(bandwidth[points[0]].keys())
+width = 0.8 / len(queue_names)
+
+plt.figure()
+for queue_no, queue_name in enumerate(queue_names):
+    averages = [sum(bandwidth[point][queue_name]) / len(bandwidth[point][queue_name]) for point in points]
+    plt.bar([point_no + queue_no * width for point_no in range(len(points))], averages, width, label=queue_name)
+plt.title(input_file_name + "  (array size = " + array_size + ")")
+plt.xticks([point_no + 0.4 - width / 2 for point_no in range(len(points))], points)
+plt.xlabel("Producers/Consumers")
+plt.ylabel("Average bandwidth (GB/s)")
+plt.legend()
+plt.savefig(input_file_name + "_pipeline.png")
+
+plt.show()